@@ -22,12 +22,17 @@ DEALINGS IN THE SOFTWARE.
 
 #include <algorithm>
 #include <cmath>
+#include "wpkernels.hpp"
+#include "wpprofile.hpp"
+
+const char *const triggerModeNames[kNumTriggerModes] = {"Crossing", "YIN"};
 
 // NOTE: This method does not attempt to delete existing sample buffers.
 // If re-initialization is desired, implement and call a "dispose"
 // method first.
 void Analyzer::initialize(BufferManager *bMan, int bufferSize) {
 	bufferManager = bMan;
+	pitchDetector.initialize(bMan);
 	
 	ampFunc.setValue(&amplitude);
 	freqFunc.setValue(&frequency);
@@ -48,10 +53,16 @@ void Analyzer::initialize(BufferManager *bMan, int bufferSize) {
 	wW = 0.0f;
 	wWNew = 1.0f;
 	trigInverted = false;
+	incrementalUpdates = false;
+	fractionalCycles = false;
+	wInterpolationMode = kInterpLinear;
+	triggerMode = kTriggerCrossing;
 	endOfCycle = kPosNeg;
 	waveBufferSize = 0;
 	oldWave = NULL;
+	pendingWave = NULL;
 	newWave = NULL;
+	pendingWaveSize = 0;
 	
 	setBufferSize(bufferSize);
 }
@@ -71,7 +82,12 @@ void Analyzer::reset(float a, float fHz) {
 	detectPeak = trigInverted;
 	oldWaveSize = 2;
 	newWaveSize = 0;
+	pendingWaveSize = 0;
 	maxSample = oldWave[0] = oldWave[1] = 0.0f;
+	cycleStart = preSample = 0.0f;
+	
+	pitchDetector.setRange(minWaveSize - 1, maxWaveSize - 1);
+	pitchDetector.reset();
 	
 	waveFunc.setFunction(oldWaveSize, oldWave);
 }
@@ -81,6 +97,7 @@ bool Analyzer::setBufferSize(int bufferSize) {
 		return true;
 	
 	bufferManager->deleteFloatBuffer(oldWave);
+	bufferManager->deleteFloatBuffer(pendingWave);
 	bufferManager->deleteFloatBuffer(newWave);
 	
 	waveBufferSize = bufferSize;
@@ -89,23 +106,37 @@ bool Analyzer::setBufferSize(int bufferSize) {
 		if (!(oldWave = bufferManager->newFloatBuffer(waveBufferSize)))
 			goto alloc_failed;
 		
+		if (!(pendingWave = bufferManager->newFloatBuffer(waveBufferSize))) {
+			bufferManager->deleteFloatBuffer(oldWave);
+			goto alloc_failed;
+		}
+		
 		if (!(newWave = bufferManager->newFloatBuffer(waveBufferSize))) {
 			bufferManager->deleteFloatBuffer(oldWave);
+			bufferManager->deleteFloatBuffer(pendingWave);
 			goto alloc_failed;
 		}
 		
+		// Falls back on crossing triggers rather than failing the buffers, which are usable.
+		if (triggerMode == kTriggerYin && !pitchDetector.allocate(waveBufferSize))
+			triggerMode = kTriggerCrossing;
+		
 		reset();
 	}
 	else {
+		pitchDetector.release();
 		oldWave = NULL;
+		pendingWave = NULL;
 		newWave = NULL;
 	}
 	
 	return true;
 	
 	alloc_failed:
+	pitchDetector.release();
 	waveBufferSize = 0;
 	oldWave = NULL;
+	pendingWave = NULL;
 	newWave = NULL;
 	return false;
 }
@@ -123,11 +154,13 @@ void Analyzer::setADecWeight(float weight) {
 void Analyzer::setFMin(float hz) {
 	fMin = std::min(hz, globalMaxFrequency);
 	maxWaveSize = std::min((int) (globalSampleRate/fMin + 0.5f) + 1, waveBufferSize);
+	pitchDetector.setRange(minWaveSize - 1, maxWaveSize - 1);
 }
 
 void Analyzer::setFMax(float hz) {
 	fMax = std::min(hz, globalMaxFrequency);
 	minWaveSize = (int) (globalSampleRate/fMax + 0.5f) + 1;
+	pitchDetector.setRange(minWaveSize - 1, maxWaveSize - 1);
 }
 
 void Analyzer::setTrigInverted(bool onOff) {
@@ -136,13 +169,54 @@ void Analyzer::setTrigInverted(bool onOff) {
 	trigDisabled = true;
 }
 
+void Analyzer::setWInterpolationMode(InterpolationMode mode) {
+	wInterpolationMode = (mode != kInterpNone) ? mode : kInterpLinear;
+	setWInterpolation(waveFunc.getInterpolation());
+}
+
+void Analyzer::setFractionalCycles(bool onOff) {
+	fractionalCycles = onOff;
+	cycleStart = 0.0f;
+}
+
+void Analyzer::setIncrementalUpdates(bool onOff) {
+	incrementalUpdates = onOff;
+	
+	if (!incrementalUpdates && pendingWaveSize > 0)
+		advancePendingWave(pendingWaveSize);
+}
+
+bool Analyzer::setTriggerMode(TriggerMode mode) {
+	if (mode == triggerMode)
+		return true;
+	
+	if (mode == kTriggerYin) {
+		if (oldWave != NULL && !pitchDetector.allocate(waveBufferSize))
+			return false;
+		pitchDetector.setRange(minWaveSize - 1, maxWaveSize - 1);
+	}
+	else
+		pitchDetector.release();
+	
+	triggerMode = mode;
+	trigCount = 0;
+	detectPeak = trigInverted;
+	cycleStart = 0.0f;
+	return true;
+}
+
 void Analyzer::addSample(float sample) {
 	// Update the amplitude output.
 	float absample = std::abs(sample);
+	amplitude = trackAmplitude(amplitude, absample);
 	
-	// NOTE: We make amplitude lower-bounded to stay out of cycle-sapping denormal territory.
-	amplitude =
-		std::max(1.0e-8f, amplitude + ((absample > amplitude) ? aIncWNew : aDecWNew) * (absample - amplitude));
+	// Continue normalizing the pending waveform, if any.
+	if (pendingWaveSize > 0)
+		advancePendingWave(WP_ANA_UPDATE_RATE);
+	
+	// The detector also listens through silence, so it has a period ready when the gate opens.
+	if (triggerMode == kTriggerYin)
+		pitchDetector.addSample(sample);
 	
 	// Skip frequency and waveform updates while the input signal is near-silent.
 	if (trigDisabled) {
@@ -151,6 +225,7 @@ void Analyzer::addSample(float sample) {
 			trigCount = 0;
 			detectPeak = trigInverted;
 			newWaveSize = 0;
+			cycleStart = 0.0f;
 			maxSample = absample;
 		}
 		else
@@ -167,25 +242,167 @@ void Analyzer::addSample(float sample) {
 		maxSample = absample;
 	
 	// Check if the trigger conditions for an F&W update are met.
-	if (newWaveSize >= maxWaveSize)
-		updateFreqAndWave(sample, absample);
-	else if (trigCount > 1) {
-		if (newWaveSize >= minWaveSize && signs(newWave[newWaveSize-2], sample) == endOfCycle)
-			updateFreqAndWave(sample, absample);
+	if (triggerMode == kTriggerYin) {
+		float period = pitchDetector.getPeriod(), length = (float) (newWaveSize - 1);
+		
+		if (newWaveSize >= maxWaveSize)
+			updateFreqAndWave(sample, absample, length);
+		else if (period > 0.0f && length >= cycleStart + period) {
+			// The boundary falls between the previous sample and this one, unless the
+			// period has just dropped.
+			updateFreqAndWave(sample, absample, std::max(cycleStart + period, length - 1.0f));
+		}
 	}
-	else if ((detectPeak) ? sample > amplitude*fHighTrig : sample < amplitude*fLowTrig) {
+	else if (isCycleEnd(
+	             newWave, newWaveSize, sample, minWaveSize, maxWaveSize, trigCount, endOfCycle))
+		updateFreqAndWave(sample, absample, cycleEndPosition(sample));
+	else if (trigCount <= 1 && isTriggerLevel(detectPeak, sample, amplitude, fHighTrig, fLowTrig)) {
 		detectPeak = !detectPeak;
 		trigCount++;
 	}
 }
 
-void Analyzer::updateFreqAndWave(float sample, float absample) {
+// Does the same as calling addSample for each of the n samples at in, but keeps the
+// tracker state in locals and only leaves the inner loops on gate changes and F&W updates.
+void Analyzer::processBlock(const float *in, int n) {
+	// The period detector runs per sample anyway, so there's little to gain from a block loop.
+	if (triggerMode == kTriggerYin) {
+		for (int i = 0; i < n; i++)
+			addSample(in[i]);
+		return;
+	}
+	
+	const float *inEnd = in + n;
+	float a = amplitude, maxS = maxSample, sample, absample;
+	
+	beginBlock(n);
+	
+	while (in != inEnd) {
+		sample = *in++;
+		absample = std::abs(sample);
+		a = trackAmplitude(a, absample);
+		
+		// Skip frequency and waveform updates while the input signal is near-silent.
+		if (trigDisabled) {
+			while (!(a > ampGateLevel | absample > sampleGateLevel)) { // Gate loop.
+				if (in == inEnd)
+					goto block_done;
+				
+				sample = *in++;
+				absample = std::abs(sample);
+				a = trackAmplitude(a, absample);
+			}
+			
+			trigDisabled = false;
+			trigCount = 0;
+			detectPeak = trigInverted;
+			newWaveSize = 0;
+			cycleStart = 0.0f;
+			maxS = absample;
+		}
+		else if (a < ampGateLevel & absample < sampleGateLevel) {
+			trigDisabled = true;
+			continue;
+		}
+		
+		for (;;) { // Recording loop.
+			// Add the sample to the sample buffer.
+			newWave[newWaveSize++] = sample;
+			if (absample > maxS)
+				maxS = absample;
+			
+			// Check if the trigger conditions for an F&W update are met.
+			if (isCycleEnd(
+			        newWave, newWaveSize, sample, minWaveSize, maxWaveSize, trigCount, endOfCycle)) {
+				amplitude = a;
+				maxSample = maxS;
+				
+				updateFreqAndWave(sample, absample, cycleEndPosition(sample));
+				
+				maxS = maxSample;
+			}
+			else if (trigCount <= 1 && isTriggerLevel(detectPeak, sample, a, fHighTrig, fLowTrig)) {
+				detectPeak = !detectPeak;
+				trigCount++;
+			}
+			
+			if (in == inEnd)
+				break;
+			
+			sample = *in++;
+			absample = std::abs(sample);
+			a = trackAmplitude(a, absample);
+			
+			if (a < ampGateLevel & absample < sampleGateLevel) {
+				trigDisabled = true;
+				break;
+			}
+		}
+	}
+	
+	block_done:
+	amplitude = a;
+	maxSample = maxS;
+}
+
+void Analyzer::loadTrackerLane(TrackerLanes &lanes, int l) {
+	lanes.aIncW[l] = aIncWNew;
+	lanes.aDecW[l] = aDecWNew;
+	lanes.ampGate[l] = ampGateLevel;
+	lanes.sampleGate[l] = sampleGateLevel;
+	lanes.highTrig[l] = fHighTrig;
+	lanes.lowTrig[l] = fLowTrig;
+	lanes.inverted[l] = -(int) trigInverted;
+	lanes.minSize[l] = minWaveSize;
+	lanes.maxSize[l] = maxWaveSize;
+	lanes.active[l] = -1;
+	
+	loadTrackerState(lanes, l);
+}
+
+void Analyzer::loadTrackerState(TrackerLanes &lanes, int l) {
+	lanes.amplitude[l] = amplitude;
+	lanes.maxSample[l] = maxSample;
+	lanes.cycleStart[l] = cycleStart;
+	lanes.previous[l] = (newWaveSize > 0) ? newWave[newWaveSize-1] : 0.0f;
+	lanes.disabled[l] = -(int) trigDisabled;
+	lanes.detectPeak[l] = -(int) detectPeak;
+	lanes.trigCount[l] = trigCount;
+	lanes.size[l] = newWaveSize;
+	lanes.record[l] = newWave;
+}
+
+void Analyzer::storeTrackerState(const TrackerLanes &lanes, int l) {
+	amplitude = lanes.amplitude[l];
+	maxSample = lanes.maxSample[l];
+	cycleStart = lanes.cycleStart[l];
+	trigDisabled = lanes.disabled[l] != 0;
+	detectPeak = lanes.detectPeak[l] != 0;
+	trigCount = lanes.trigCount[l];
+	newWaveSize = lanes.size[l];
+}
+
+// Same as the trigger branch of processBlock.
+void Analyzer::endTrackerCycle(TrackerLanes &lanes, int l) {
+	storeTrackerState(lanes, l);
+	
+	float sample = newWave[newWaveSize-1];
+	updateFreqAndWave(sample, std::abs(sample), cycleEndPosition(sample));
+	
+	// The recording buffer may have been swapped.
+	loadTrackerState(lanes, l);
+}
+
+void Analyzer::updateFreqAndWave(float sample, float absample, float cycleEnd) {
+	WP_PROFILE_PROBE(kProbeUpdateWave);
+	
 	// Reset update trigger.
 	trigCount = 0;
 	detectPeak = trigInverted;
 	
 	// Compute frequency, with lag if that is turned on.
-	frequency += fWNew*(hzToUnsigned(globalSampleRate/(newWaveSize-1)) - frequency);
+	float period = cycleEnd - cycleStart;
+	frequency += fWNew*(hzToUnsigned(globalSampleRate/period) - frequency);
 	
 	// Normalize the waveform.
 	// 1.0e-8f is added to values used as denominators to prevent DbZ problems.
@@ -211,39 +428,85 @@ void Analyzer::updateFreqAndWave(float sample, float absample) {
 	// subtraction here, we would have to write something like
 	//   newWave[i] = copysignf(limiterGain*(std::abs(newWave[i]) - maxNormal) + distLevel,
 	//                          newWave[i]);
-	// inside the normalization loop.
+	// inside the normalization kernel.
 	distLevel -= limiterGain*maxNormal;
 	
-	for (int i = 0; i < newWaveSize; i++) { // Normalization loop.
-		if (std::abs(newWave[i]) > maxNormal) {
-			newWave[i] *= limiterGain;
-			newWave[i] += copysignf(distLevel, newWave[i]);
-		}
-		else
-			newWave[i] *= normalizerGain;
-	}
+	// Only one waveform can be pending. Finish the previous one if it isn't done yet.
+	if (pendingWaveSize > 0)
+		advancePendingWave(pendingWaveSize);
 	
-	// Apply waveform lag if that is turned on.
-	if (wWNew < 1.0f) {
-		float d = 2.0f / newWaveSize, x = -1.0f;
-		
-		for (int i = 0; i < newWaveSize; i++) {
-			float value = waveFunc.getValue(x);
-			value += wWNew*(newWave[i] - value);
-			newWave[i] = copysignf(std::max(1.0e-8f, std::abs(value)), value);
-			x += d;
-		}
-	}
+	float lastButOne = (newWaveSize > 1) ? newWave[newWaveSize-2] : preSample;
 	
-	// Update signal source for waveform output object.
-	waveFunc.setFunction(newWaveSize, newWave);
+	// Resample the recording into the pending (now unused) buffer, or swap the two.
+	if (fractionalCycles && newWaveSize > 2)
+		resampleCycle(cycleEnd);
+	else
+		std::swap(pendingWave, newWave);
+	pendingWaveSize = newWaveSize;
+	pendingWaveDone = 0;
+	pendingMaxNormal = maxNormal;
+	pendingNormalizerGain = normalizerGain;
+	pendingLimiterGain = limiterGain;
+	pendingDistLevel = distLevel;
+	pendingWWNew = wWNew;
 	
-	// Swap the waveform output (oldWave) and recording (newWave) buffer pointers.
-	std::swap(oldWave, newWave);
-	oldWaveSize = newWaveSize;
+	if (!incrementalUpdates)
+		advancePendingWave(pendingWaveSize);
 	
-	// Reset the new waveform.
+	// Reset the new waveform. The next cycle starts where this one ends.
+	cycleStart = cycleEnd - (newWaveSize - 1);
+	preSample = lastButOne;
 	newWaveSize = 1;
 	newWave[0] = sample;
 	maxSample = absample;
 }
+
+// Writes the recording, resampled to newWaveSize points from cycleStart to cycleEnd, to
+// pendingWave. Positions before newWave[0] are interpolated from preSample.
+void Analyzer::resampleCycle(float cycleEnd) {
+	int last = newWaveSize - 1;
+	float step = (cycleEnd - cycleStart) / last;
+	
+	for (int k = 0; k < last; k++) {
+		float position = cycleStart + k*step;
+		
+		if (position < 0.0f)
+			pendingWave[k] = preSample + (position + 1.0f) * (newWave[0] - preSample);
+		else {
+			int i = std::min((int) position, last - 1);
+			float weight = position - i;
+			pendingWave[k] = newWave[i] + weight * (newWave[i+1] - newWave[i]);
+		}
+	}
+	
+	// Exactly the end of the cycle, which is a zero crossing unless the cycle was cut off.
+	int i = std::min((int) cycleEnd, last - 1);
+	pendingWave[last] = newWave[i] + (cycleEnd - i) * (newWave[i+1] - newWave[i]);
+}
+
+void Analyzer::advancePendingWave(int nSamples) {
+	int first = pendingWaveDone, count = std::min(nSamples, pendingWaveSize - pendingWaveDone);
+	
+	normalizeWave(
+		pendingWave + first, count,
+		pendingMaxNormal, pendingNormalizerGain, pendingLimiterGain, pendingDistLevel);
+	
+	// Apply waveform lag if that is turned on.
+	// The old waveform is resampled to the new size and blended with the new waveform.
+	if (pendingWWNew < 1.0f)
+		lagWave(
+			pendingWave, pendingWaveSize, first, count, waveFunc.getSamples(), waveFunc.getSize(),
+			waveFunc.getInterpolation(), pendingWWNew);
+	
+	pendingWaveDone += count;
+	
+	if (pendingWaveDone == pendingWaveSize) {
+		// Update signal source for waveform output object.
+		waveFunc.setFunction(pendingWaveSize, pendingWave);
+		
+		// Swap the waveform output (oldWave) and pending buffer pointers.
+		std::swap(oldWave, pendingWave);
+		oldWaveSize = pendingWaveSize;
+		pendingWaveSize = 0;
+	}
+}
@@ -23,6 +23,25 @@ DEALINGS IN THE SOFTWARE.
 
 #include "wpfunc.hpp"
 #include "BufferManager.hpp"
+#include "PitchDetector.hpp"
+#include "wpkernels.hpp"
+
+// Number of samples of a captured cycle that are normalized (and lagged) per input sample
+// when incremental updates are on.
+#define WP_ANA_UPDATE_RATE 4
+
+// Lower bound of the amplitude output.
+#define WP_ANA_MIN_AMPLITUDE WP_TRACKER_MIN_AMPLITUDE
+
+// How the end of a cycle is detected.
+enum TriggerMode {
+	kTriggerCrossing, // Zero crossing after a peak above the high and a trough below the low trigger level.
+	kTriggerYin,      // Cycle length from a YIN period estimate (see PitchDetector).
+	
+	kNumTriggerModes
+};
+
+extern const char *const triggerModeNames[kNumTriggerModes];
 
 class Analyzer {
 private:
@@ -33,18 +52,34 @@ private:
 	
 	float aIncW, aDecW, ampGateLevel, sampleGateLevel,
 	      fHighTrig, fLowTrig, fMin, fMax, fW, wW;
-	bool trigInverted;
+	bool trigInverted, incrementalUpdates, fractionalCycles;
+	InterpolationMode wInterpolationMode;
+	TriggerMode triggerMode;
+	
+	// Only allocated in kTriggerYin mode.
+	PitchDetector pitchDetector;
 	
-	float *oldWave, *newWave;
+	// The waveform output (oldWave), the captured cycle that is being normalized
+	// before it replaces the output (pendingWave) and the recording (newWave).
+	float *oldWave, *pendingWave, *newWave;
 	
 	SignCode endOfCycle;
 	bool trigDisabled, detectPeak;
 	int waveBufferSize, minWaveSize, maxWaveSize, oldWaveSize, newWaveSize, trigCount;
 	float aWeightModifier, aIncWNew, aDecWNew, fWNew, wWNew, amplitude, frequency, maxSample;
 	
+	// Position of the start of the recorded cycle relative to newWave[0], in (-1, 0], and the
+	// sample before newWave[0]. The start is 0 unless cycles have fractional lengths.
+	float cycleStart, preSample;
+	
+	// Normalization state of the pending waveform. pendingWaveSize is 0 if there is none.
+	int pendingWaveSize, pendingWaveDone;
+	float pendingMaxNormal, pendingNormalizerGain, pendingLimiterGain, pendingDistLevel,
+	      pendingWWNew;
+	
 public:
 	void initialize(BufferManager *bMan, int bufferSize = 0);
-	void reset(float a = 1.0e-8f, float fHz = 440.0f); // 440Hz = concert A.
+	void reset(float a = WP_ANA_MIN_AMPLITUDE, float fHz = 440.0f); // 440Hz = concert A.
 	
 	RealFunction *getAmpFunction() {return &ampFunc;}
 	RealFunction *getFreqFunction() {return &freqFunc;}
@@ -65,6 +100,10 @@ public:
 	float getWWeight() {return wW;}
 	bool getTrigInverted() {return trigInverted;}
 	bool getWInterpolation() {return waveFunc.getInterpolation();}
+	InterpolationMode getWInterpolationMode() {return wInterpolationMode;}
+	bool getIncrementalUpdates() {return incrementalUpdates;}
+	bool getFractionalCycles() {return fractionalCycles;}
+	TriggerMode getTriggerMode() {return triggerMode;}
 	
 	void setAIncWeight(float weight);
 	void setADecWeight(float weight);
@@ -77,15 +116,87 @@ public:
 	void setFWeight(float weight) {fW = weight; fWNew = 1.0f - weight;}
 	void setWWeight(float weight) {wW = weight; wWNew = 1.0f - weight;}
 	void setTrigInverted(bool onOff);
-	void setWInterpolation(bool onOff) {waveFunc.setInterpolation(onOff);}
+	
+	// Waveform interpolation is either off or uses the interpolation mode (linear by default).
+	// Setting the mode to kInterpNone selects kInterpLinear.
+	void setWInterpolation(bool onOff) {
+		waveFunc.setInterpolationMode((onOff) ? wInterpolationMode : kInterpNone);
+	}
+	void setWInterpolationMode(InterpolationMode mode);
+	
+	// When on, a captured cycle is normalized and lagged a few samples at a time over the
+	// following input samples (see WP_ANA_UPDATE_RATE) and only then replaces the waveform
+	// output, instead of all at once on the sample that completes the cycle.
+	void setIncrementalUpdates(bool onOff);
+	
+	// When on, zero-crossing cycle boundaries are placed between samples by linear
+	// interpolation, so the frequency isn't quantized to whole-sample periods. Each captured
+	// cycle is resampled to run exactly from boundary to boundary before it's published.
+	// In kTriggerYin mode the boundaries come from the fractional period instead.
+	void setFractionalCycles(bool onOff);
+	
+	// In kTriggerYin mode a cycle ends when it's as long as the latest period estimate, so
+	// noisy or harmonically rich input that crosses zero several times per period still gives
+	// steady cycles. Cycles then start at an arbitrary point of the period, and the trigger
+	// levels and inversion are ignored. The estimate looks at up to two periods of the lowest
+	// frequency (FMin), so a low FMin makes it slow to follow pitch changes.
+	// Returns false if the detector couldn't be allocated, leaving the mode unchanged.
+	bool setTriggerMode(TriggerMode mode);
 	
 	void addSample(float sample);
+	void processBlock(const float *in, int n);
+	
+	// The steps of processBlock in kTriggerCrossing mode, for stepping the amplitude followers
+	// and crossing triggers of several analyzers side by side with trackLanes (see
+	// WaveEngineBatch). A block of n samples starts with beginBlock. loadTrackerLane copies the
+	// settings and tracker state to lane l, storeTrackerState copies the state back, which must
+	// be done before anything else reads the analyzer, and endTrackerCycle ends the cycle of a
+	// lane that trackLanes reports as ended.
+	void beginBlock(int n) {
+		// Continue normalizing the pending waveform, if any.
+		if (pendingWaveSize > 0)
+			advancePendingWave(WP_ANA_UPDATE_RATE * n);
+	}
+	void loadTrackerLane(TrackerLanes &lanes, int l);
+	void storeTrackerState(const TrackerLanes &lanes, int l);
+	void endTrackerCycle(TrackerLanes &lanes, int l);
 	
 	float getAmplitude() {return amplitude;}
 	float getFrequency() {return frequency;}
 	
+	// True while the input is gated, the amplitude is at its lower bound and there's no
+	// pending waveform. Samples no louder than WP_ANA_MIN_AMPLITUDE then leave the analyzer
+	// unchanged, so they needn't be processed. Never true in kTriggerYin mode, where the
+	// period detector listens through silence.
+	bool isIdle() {
+		return trigDisabled & amplitude <= WP_ANA_MIN_AMPLITUDE & pendingWaveSize == 0 &
+		       triggerMode == kTriggerCrossing;
+	}
+	
 private:
-	void updateFreqAndWave(float sample, float absample);
+	float trackAmplitude(float a, float absample) {
+		return followAmplitude(a, absample, aIncWNew, aDecWNew);
+	}
+	
+	// Fractional position in newWave of the zero crossing between previous and sample, the last
+	// two recorded samples. Without fractional cycles it's the position of sample.
+	float crossingPosition(float previous, float sample) {
+		return (newWaveSize - 2) + ((fractionalCycles) ? previous / (previous - sample) : 1.0f);
+	}
+	
+	// Position in newWave of the end of a cycle isCycleEnd reports, where sample is the last
+	// recorded sample.
+	float cycleEndPosition(float sample) {
+		return (newWaveSize >= maxWaveSize)
+		       ? (float) (newWaveSize - 1) : crossingPosition(newWave[newWaveSize-2], sample);
+	}
+	
+	// cycleEnd is the position of the end of the recorded cycle in newWave. It's fractional
+	// with fractional cycles or in kTriggerYin mode.
+	void updateFreqAndWave(float sample, float absample, float cycleEnd);
+	void resampleCycle(float cycleEnd);
+	void advancePendingWave(int nSamples);
+	void loadTrackerState(TrackerLanes &lanes, int l);
 };
 
 #endif
@@ -25,15 +25,7 @@ DEALINGS IN THE SOFTWARE.
 #include <stdexcept>
 
 BufferManager::BufferManager() {
-#ifdef WP_OLD_WINDOWS
-	InitializeCriticalSection(&myCriticalSection);
-#else
-	if (!InitializeCriticalSectionAndSpinCount(&myCriticalSection, 0x80000400))
-		throw std::runtime_error(
-			"BufferManager::BufferManager - Failed to initialize critical section.");
-#endif
-	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	intBuffers = NULL;
 	floatBuffers = NULL;
@@ -49,18 +41,16 @@ BufferManager::BufferManager() {
 		floatBuffers = NULL;
 	}
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	if (intBuffers == NULL) {
-		DeleteCriticalSection(&myCriticalSection);
-		
 		throw std::runtime_error(
 			"BufferManager::BufferManager - Failed to create buffer vectors.");
 	}
 }
 
 BufferManager::~BufferManager() {
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	std::for_each(intBuffers->begin(), intBuffers->end(), &deleteBuffer<int>);
 	std::for_each(floatBuffers->begin(), floatBuffers->end(), &deleteBuffer<float>);
@@ -68,9 +58,7 @@ BufferManager::~BufferManager() {
 	delete intBuffers;
 	delete floatBuffers;
 	
-	LeaveCriticalSection(&myCriticalSection);
-	
-	DeleteCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 }
 
 int *BufferManager::newIntBuffer(int size) {
@@ -83,11 +71,11 @@ int *BufferManager::newIntBuffer(int size) {
 		return NULL;
 	}
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	intBuffers->push_back(buffer);
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	return buffer;
 }
@@ -102,11 +90,11 @@ float *BufferManager::newFloatBuffer(int size) {
 		return NULL;
 	}
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	floatBuffers->push_back(buffer);
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	return buffer;
 }
@@ -114,7 +102,7 @@ float *BufferManager::newFloatBuffer(int size) {
 bool BufferManager::deleteIntBuffer(int *ptr) {
 	bool found = false;
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	std::vector<int *>::iterator result =
 		std::find(intBuffers->begin(), intBuffers->end(), ptr);
@@ -124,7 +112,7 @@ bool BufferManager::deleteIntBuffer(int *ptr) {
 		intBuffers->erase(result);
 	}
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	if (found)
 		delete[] ptr;
@@ -135,7 +123,7 @@ bool BufferManager::deleteIntBuffer(int *ptr) {
 bool BufferManager::deleteFloatBuffer(float *ptr) {
 	bool found = false;
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	std::vector<float *>::iterator result =
 		std::find(floatBuffers->begin(), floatBuffers->end(), ptr);
@@ -145,7 +133,7 @@ bool BufferManager::deleteFloatBuffer(float *ptr) {
 		floatBuffers->erase(result);
 	}
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	if (found)
 		delete[] ptr;
@@ -24,7 +24,7 @@ DEALINGS IN THE SOFTWARE.
 #include "wpstdinclude.h"
 
 #include <vector>
-#include <windows.h>
+#include "wpsync.hpp"
 
 class BufferManager {
 private:
@@ -32,7 +32,7 @@ private:
 	static void deleteBuffer(T *ptr) {delete[] ptr;}
 	
 protected:
-	CRITICAL_SECTION myCriticalSection;
+	CriticalSection myCriticalSection;
 	
 private:
 	std::vector<int *> *intBuffers;
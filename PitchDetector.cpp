@@ -0,0 +1,261 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "PitchDetector.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include "wpfft.hpp"
+
+// Smallest hop between estimates, in samples.
+#define WP_PITCH_MIN_HOP 64
+
+void PitchDetector::initialize(BufferManager *bMan) {
+	bufferManager = bMan;
+	history = decimated = workRe = workIm = difference = NULL;
+	historySize = historyMask = periodLimit = 0;
+	minPeriod = maxPeriod = 0;
+	hop = hopLeft = 0;
+}
+
+bool PitchDetector::allocate(int maxPeriodLimit) {
+	release();
+	
+	// A window and the largest lag (plus one for interpolation) at the decimated rate.
+	int maxDecimation = (maxPeriodLimit + WP_PITCH_MAX_LAG - 1) / WP_PITCH_MAX_LAG,
+	    fftSize = 1 << WP_PITCH_MAX_LOG2_FFT_SIZE;
+	
+	historySize = 1;
+	while (historySize < (2*WP_PITCH_MAX_LAG + 1) * maxDecimation)
+		historySize <<= 1;
+	historyMask = historySize - 1;
+	periodLimit = maxPeriodLimit;
+	
+	if (!(history = bufferManager->newFloatBuffer(historySize)))
+		goto alloc_failed;
+	if (!(decimated = bufferManager->newFloatBuffer(2*WP_PITCH_MAX_LAG + 1)))
+		goto alloc_failed;
+	if (!(workRe = bufferManager->newFloatBuffer(fftSize)))
+		goto alloc_failed;
+	if (!(workIm = bufferManager->newFloatBuffer(fftSize)))
+		goto alloc_failed;
+	if (!(difference = bufferManager->newFloatBuffer(WP_PITCH_MAX_LAG + 2)))
+		goto alloc_failed;
+	
+	setRange(minPeriod, maxPeriod);
+	reset();
+	return true;
+	
+	alloc_failed:
+	release();
+	return false;
+}
+
+void PitchDetector::release() {
+	bufferManager->deleteFloatBuffer(history);
+	bufferManager->deleteFloatBuffer(decimated);
+	bufferManager->deleteFloatBuffer(workRe);
+	bufferManager->deleteFloatBuffer(workIm);
+	bufferManager->deleteFloatBuffer(difference);
+	history = decimated = workRe = workIm = difference = NULL;
+	historySize = historyMask = periodLimit = 0;
+}
+
+void PitchDetector::setRange(int minPeriodSamples, int maxPeriodSamples) {
+	minPeriod = minPeriodSamples;
+	maxPeriod = maxPeriodSamples;
+	
+	if (history == NULL)
+		return;
+	
+	int maxP = std::max(2, std::min(maxPeriod, periodLimit)),
+	    minP = std::max(1, std::min(minPeriod, maxP - 1));
+	
+	decimation = (maxP + WP_PITCH_MAX_LAG - 1) / WP_PITCH_MAX_LAG;
+	maxLag = (maxP + decimation - 1) / decimation;
+	minLag = std::max(1, minP / decimation);
+	
+	// The correlation must not wrap around: 2^log2FFTSize > window + maxLag + 1.
+	for (log2FFTSize = 1; (1 << log2FFTSize) < 2*maxLag + 2; log2FFTSize++);
+	
+	// The history is kept, so the next estimate comes no later than it would have.
+	hop = std::max(maxP / 2, WP_PITCH_MIN_HOP);
+	hopLeft = std::min(hopLeft, hop);
+}
+
+void PitchDetector::reset() {
+	if (history == NULL)
+		return;
+	
+	std::memset(history, 0, historySize * sizeof (float));
+	writePos = nFilled = 0;
+	hopLeft = hop;
+	period = 0.0f;
+}
+
+void PitchDetector::estimate() {
+	// The window is maxLag decimated samples and lags go up to maxLag + 1.
+	const int window = maxLag, nDecimated = 2*maxLag + 1, n = 1 << log2FFTSize;
+	const int nNeeded = nDecimated * decimation;
+	
+	if (nFilled < nNeeded)
+		return;
+	
+	// Box-filter and decimate the latest samples.
+	const float scale = 1.0f / decimation;
+	double energy = 0.0;
+	
+	for (int k = 0, pos = writePos - nNeeded; k < nDecimated; k++) {
+		float sum = 0.0f;
+		for (int i = 0; i < decimation; i++)
+			sum += history[(pos++) & historyMask];
+		decimated[k] = sum * scale;
+		energy += (double) decimated[k] * decimated[k];
+	}
+	
+	// Skip the transforms on silence (below -120 dB).
+	if (energy < 1.0e-12 * nDecimated) {
+		period = 0.0f;
+		return;
+	}
+	
+	// The autocorrelation r(tau) of the window with the signal tau samples later is the
+	// inverse transform of conj(A)*B, where A and B are the spectra of the window and of
+	// the whole signal. Both are taken with one complex FFT of window + i*signal.
+	for (int j = 0; j < n; j++) {
+		workRe[j] = (j < window) ? decimated[j] : 0.0f;
+		workIm[j] = (j < nDecimated) ? decimated[j] : 0.0f;
+	}
+	
+	fft(workRe, workIm, log2FFTSize);
+	
+	for (int k = 0; k <= n/2; k++) {
+		int m = (n - k) & (n - 1);
+		float zRe = workRe[k], zIm = workIm[k], wRe = workRe[m], wIm = workIm[m];
+		
+		// A = (Z[k] + conj(Z[n-k]))/2, B = (Z[k] - conj(Z[n-k]))/2i.
+		float aRe = 0.5f*(zRe + wRe), aIm = 0.5f*(zIm - wIm),
+		      bRe = 0.5f*(zIm + wIm), bIm = -0.5f*(zRe - wRe);
+		
+		// C = conj(A)*B. The correlation is real, so C[n-k] = conj(C[k]).
+		float cRe = aRe*bRe + aIm*bIm, cIm = aRe*bIm - aIm*bRe;
+		workRe[k] = cRe;
+		workIm[k] = cIm;
+		workRe[m] = cRe;
+		workIm[m] = -cIm;
+	}
+	
+	fft(workRe, workIm, log2FFTSize, true);
+	
+	// Difference function d(tau) = e(0) + e(tau) - 2r(tau), where e(tau) is the energy of
+	// the window starting at tau, and its cumulative mean normalized form.
+	double e0 = 0.0, eTau, dSum = 0.0;
+	for (int j = 0; j < window; j++)
+		e0 += (double) decimated[j] * decimated[j];
+	eTau = e0;
+	
+	difference[0] = 1.0f;
+	for (int tau = 1; tau <= maxLag + 1; tau++) {
+		eTau += (double) decimated[tau + window - 1] * decimated[tau + window - 1]
+		      - (double) decimated[tau - 1] * decimated[tau - 1];
+		
+		double d = std::max(0.0, e0 + eTau - 2.0 * workRe[tau] / n);
+		dSum += d;
+		difference[tau] = (dSum > 0.0) ? (float) (d * tau / dSum) : 1.0f;
+	}
+	
+	// First dip below the threshold, or the deepest one.
+	int tau = -1, best = minLag;
+	for (int t = minLag; t <= maxLag; t++) {
+		if (difference[t] < WP_PITCH_THRESHOLD) {
+			while (t < maxLag && difference[t+1] < difference[t])
+				t++;
+			tau = t;
+			break;
+		}
+		
+		if (difference[t] < difference[best])
+			best = t;
+	}
+	
+	if (tau < 0) {
+		if (difference[best] > WP_PITCH_UNVOICED) {
+			period = 0.0f;
+			return;
+		}
+		tau = best;
+	}
+	
+	// Parabolic interpolation around the dip.
+	float y0 = difference[tau-1], y1 = difference[tau], y2 = difference[tau+1];
+	float denom = y0 - 2.0f*y1 + y2, offset = 0.0f;
+	if (denom > 0.0f)
+		offset = std::max(-0.5f, std::min(0.5f * (y0 - y2) / denom, 0.5f));
+	
+	float p = (tau + offset) * decimation;
+	if (decimation > 1)
+		p = refine(p);
+	
+	period = (p >= minPeriod && p <= maxPeriod) ? p : 0.0f;
+}
+
+// Plain difference function of the full-rate signal over window samples from start.
+// window must be a multiple of 4.
+static float directDifference(const float *history, int mask, int start, int window, int tau) {
+	// Four partial sums so the additions don't wait on each other.
+	float d0 = 0.0f, d1 = 0.0f, d2 = 0.0f, d3 = 0.0f;
+	for (int j = start, end = start + window; j < end; j += 4) {
+		float e0 = history[j & mask] - history[(j + tau) & mask],
+		      e1 = history[(j+1) & mask] - history[(j + 1 + tau) & mask],
+		      e2 = history[(j+2) & mask] - history[(j + 2 + tau) & mask],
+		      e3 = history[(j+3) & mask] - history[(j + 3 + tau) & mask];
+		d0 += e0*e0;
+		d1 += e1*e1;
+		d2 += e2*e2;
+		d3 += e3*e3;
+	}
+	return (d0 + d1) + (d2 + d3);
+}
+
+// Searches the plain difference function of the full-rate signal within one decimation
+// step of coarsePeriod.
+float PitchDetector::refine(float coarsePeriod) {
+	int center = (int) (coarsePeriod + 0.5f);
+	int lo = std::max(2, center - decimation), hi = center + decimation;
+	int window = WP_PITCH_REFINE_WINDOW, start = writePos - (window + hi + 1);
+	
+	int best = lo;
+	float dBest = directDifference(history, historyMask, start, window, lo);
+	for (int tau = lo + 1; tau <= hi; tau++) {
+		float d = directDifference(history, historyMask, start, window, tau);
+		if (d < dBest) {
+			best = tau;
+			dBest = d;
+		}
+	}
+	
+	float y0 = directDifference(history, historyMask, start, window, best - 1),
+	      y2 = directDifference(history, historyMask, start, window, best + 1);
+	float denom = y0 - 2.0f*dBest + y2;
+	if (denom <= 0.0f)
+		return (float) best;
+	
+	return best + std::max(-0.5f, std::min(0.5f * (y0 - y2) / denom, 0.5f));
+}
@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_PITCHDETECTOR_HPP
+#define WP_PITCHDETECTOR_HPP
+
+#include "BufferManager.hpp"
+
+// Largest lag searched at the decimated rate. Longer periods are searched on a signal
+// decimated by the smallest factor that brings them down to this many lags.
+#define WP_PITCH_MAX_LAG 512
+#define WP_PITCH_MAX_LOG2_FFT_SIZE 11 // Holds the 2*WP_PITCH_MAX_LAG + 1 correlated samples.
+
+// YIN thresholds on the cumulative mean normalized difference. The first dip below
+// WP_PITCH_THRESHOLD is taken as the period. If there is none, the deepest dip is taken
+// unless it is above WP_PITCH_UNVOICED, in which case the input has no clear period.
+#define WP_PITCH_THRESHOLD 0.15f
+#define WP_PITCH_UNVOICED 0.4f
+
+// Samples used for the full-rate refinement of a period found on a decimated signal.
+#define WP_PITCH_REFINE_WINDOW 512
+
+// YIN period estimator (de Cheveigné and Kawahara, 2002) running on a sliding window.
+// Every hop (half a window) the difference function over the last window is computed from
+// an FFT autocorrelation, and the period is taken from its normalized form and refined to a
+// fraction of a sample with parabolic interpolation.
+class PitchDetector {
+private:
+	BufferManager *bufferManager;
+	
+	// Input history. The size is a power of 2.
+	float *history;
+	int historySize, historyMask, writePos, nFilled, periodLimit;
+	
+	// Decimated signal, FFT work space and normalized difference function.
+	float *decimated, *workRe, *workIm, *difference;
+	
+	int minPeriod, maxPeriod, decimation, minLag, maxLag, log2FFTSize, hop, hopLeft;
+	float period;
+	
+public:
+	void initialize(BufferManager *bMan);
+	
+	// Allocates room for periods up to maxPeriodLimit samples. The detector can only be used
+	// while allocated.
+	bool allocate(int maxPeriodLimit);
+	void release();
+	bool isAllocated() {return history != NULL;}
+	
+	// Periods searched, in samples. maxPeriod is limited to the allocated size. The input
+	// history is kept, so range changes (such as FMin and FMax automation) don't restart the
+	// detection. The history always covers the allocated size.
+	void setRange(int minPeriodSamples, int maxPeriodSamples);
+	
+	// Clears the input history and the estimate. allocate restarts the detection this way.
+	void reset();
+	
+	void addSample(float sample) {
+		history[writePos] = sample;
+		writePos = (writePos + 1) & historyMask;
+		nFilled += nFilled < historySize;
+		
+		if (--hopLeft == 0) {
+			hopLeft = hop;
+			estimate();
+		}
+	}
+	
+	// Latest period estimate in samples, or 0 if the input has no clear period.
+	float getPeriod() {return period;}
+	
+private:
+	void estimate();
+	float refine(float coarsePeriod);
+};
+
+#endif
@@ -19,12 +19,94 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include "Synthesizer.hpp"
+#include "wpkernels.hpp"
+#include "wpprofile.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
-#define SAMPLEINDEX(x) (((x) + samplesSize) % samplesSize)
-#define WINDOWINC(x) ((x) % windowPositionsSize)
-#define WINDOWINDEX(x) (((x) + windowPositionsSize) % windowPositionsSize)
+#define SAMPLEINDEX(x) ((x) & samplesMask)
+#define WINDOWINC(x) ((x) & windowPositionsMask)
+
+const char *const decimationFilterNames[kNumDecimFilters] = {"Box", "Low", "Medium", "High"};
+
+// Zeroth order modified Bessel function of the first kind, for the Kaiser window.
+static double besselI0(double x) {
+	double sum = 1.0, term = 1.0, q = 0.25*x*x;
+	
+	for (int k = 1; term > 1e-12*sum; k++) {
+		term *= q / ((double) k*k);
+		sum += term;
+	}
+	return sum;
+}
+
+// Kaiser windowed sinc lowpass filters for every decimation filter and oversampling multiplier
+// above 1, with their cutoffs at the output Nyquist frequency, normalized to unity gain at DC.
+// They are designed once, when the first synthesizer is initialized, so changing the filter or
+// the multiplier on the processing thread only picks another one.
+#define WP_SYN_DECIM_BANK_SIZE ((8 + 16 + 32) * (16*17/2 - 1))
+
+static const int decimTapsPerPhase[kNumDecimFilters] = {0, 8, 16, 32};
+
+struct DecimationFilterBank {
+	float coefficients[WP_SYN_DECIM_BANK_SIZE];
+	const float *filters[kNumDecimFilters][17];
+};
+
+static void designDecimationFilter(float *h, int nTaps, int multiplier, double beta) {
+	const double pi = 3.14159265358979323846;
+	double center = 0.5*(nTaps - 1), sum = 0.0, windowScale = 1.0 / besselI0(beta);
+	
+	for (int k = 0; k < nTaps; k++) {
+		double t = (k - center) / multiplier, r = (k - center) / center;
+		double sinc = (t == 0.0) ? 1.0 : std::sin(pi*t) / (pi*t);
+		double v = sinc * besselI0(beta*std::sqrt(1.0 - r*r)) * windowScale;
+		
+		h[k] = (float) v;
+		sum += v;
+	}
+	
+	for (int k = 0; k < nTaps; k++)
+		h[k] = (float) (h[k] / sum);
+}
+
+static DecimationFilterBank *designDecimationFilters() {
+	static const double kaiserBeta[kNumDecimFilters] = {0.0, 5.0, 7.0, 9.0};
+	static DecimationFilterBank bank;
+	float *h = bank.coefficients;
+	
+	for (int f = 0; f < kNumDecimFilters; f++) {
+		for (int m = 0; m <= 16; m++) {
+			int nTaps = decimTapsPerPhase[f]*m;
+			
+			if (m < 2 || nTaps == 0) {
+				bank.filters[f][m] = NULL;
+				continue;
+			}
+			
+			designDecimationFilter(h, nTaps, m, kaiserBeta[f]);
+			bank.filters[f][m] = h;
+			h += nTaps;
+		}
+	}
+	
+	return &bank;
+}
+
+static const DecimationFilterBank &getDecimationFilters() {
+	static const DecimationFilterBank *bank = designDecimationFilters();
+	return *bank;
+}
+
+// Smallest power of 2 >= n.
+static int ceilPowerOf2(int n) {
+	int p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
 
 void Synthesizer::initialize(
 	BufferManager *bMan,
@@ -38,16 +120,27 @@ void Synthesizer::initialize(
 	inA = inputA;
 	inF = inputF;
 	inW = inputW;
-	aOffset = 0.0f;
-	aGain = 1.0f;
-	fOffset = 0.0f;
-	fGain = 1.0f;
-	samplesSize = 0;
+	aOffset = ParameterRamp(kRampLinear, 0.0f);
+	aGain = ParameterRamp(kRampExponential, 1.0f);
+	fOffset = ParameterRamp(kRampLinear, 0.0f);
+	fGain = ParameterRamp(kRampExponential, 1.0f);
+	rampSamples = 0;
+	samplesSize = samplesMask = samplesCapacity = 0;
 	samples = NULL;
 	windowPositions = NULL;
-	fadeBuffer = NULL;
+	fadeBuffer = fadeShape = fadeRamp = NULL;
 	aValue = 0.0f;
 	fValue = 0.0f;
+	bandLimited = false;
+	decimationFilter = kDecimBox;
+	decimTaps = 0;
+	decimMultiplier = 1;
+	decimCoefficients = NULL;
+	lastPoint = 0.0f;
+	wavetable.initialize(bMan);
+	
+	// Design the decimation filters now rather than on the processing thread.
+	getDecimationFilters();
 	
 	setBufferSize(bufferSize);
 	setOversamplingMultiplier(1);
@@ -60,13 +153,17 @@ void Synthesizer::reset() {
 	
 	start = last = 0;
 	end = 1;
-	samples[0] = 0.0f;
+	samples[0] = samples[samplesSize] = 0.0f;
 	audioFunc.setValue(samples);
 	
 	startWin = endWin = nWindows = 0;
 	
 	aValue = fValue = sampleFraction = 0.0f;
 	
+	// Clear the decimator history.
+	std::memset(pointBuffer, 0, sizeof pointBuffer);
+	lastPoint = 0.0f;
+	
 	windowSize = (int) ((smoothingWindow * globalSampleRate)/WP_STD_SAMPLE_RATE);
 	
 	if (windowSize > 0) {
@@ -76,32 +173,43 @@ void Synthesizer::reset() {
 		
 		bufferManager->deleteFloatBuffer(fadeBuffer);
 		
-		if (!(fadeBuffer = bufferManager->newFloatBuffer(windowSize))) { // VERY little memory left.
+		if (!(fadeBuffer = bufferManager->newFloatBuffer(4 * windowSize))) { // VERY little memory left.
 			smoothingWindow = windowSize = 0;
 			return;
 		}
 		
+		fadeShape = fadeBuffer;
+		fadeRamp = fadeBuffer + 2 * windowSize;
+		
+		// Sample i steps from the boundary on either side. The left half runs towards it.
 		float x = -1.0f/windowSize - 1.0f, xDelta = 2.0f/windowSize;
 		for (int i = 0; i < windowSize; i++) {
 			x += xDelta;
-			fadeBuffer[i] = 0.5f * (1.0f - fade(x));
+			float f = 0.5f * (1.0f - fade(x));
+			
+			fadeShape[windowSize-1 - i] = f;
+			fadeShape[windowSize + i] = -f;
+			fadeRamp[windowSize-1 - i] = fadeRamp[windowSize + i] = i * f;
 		}
 	}
 }
 
 bool Synthesizer::setBufferSize(int bufferSize) {
-	if (bufferSize == samplesSize)
+	if (bufferSize == samplesCapacity)
 		return true;
 	
 	bufferManager->deleteFloatBuffer(samples);
 	bufferManager->deleteIntBuffer(windowPositions);
 	
-	samplesSize = bufferSize;
+	samplesCapacity = bufferSize;
 	
-	if (samplesSize > 0) {
-		windowPositionsSize = samplesSize/2 + 1;
+	if (samplesCapacity > 0) {
+		samplesSize = ceilPowerOf2(samplesCapacity);
+		samplesMask = samplesSize - 1;
+		windowPositionsSize = ceilPowerOf2(samplesCapacity/2 + 1);
+		windowPositionsMask = windowPositionsSize - 1;
 		
-		if (!(samples = bufferManager->newFloatBuffer(samplesSize)))
+		if (!(samples = bufferManager->newFloatBuffer(2 * samplesSize)))
 			goto alloc_failed;
 		
 		if (!(windowPositions = bufferManager->newIntBuffer(windowPositionsSize))) {
@@ -112,6 +220,7 @@ bool Synthesizer::setBufferSize(int bufferSize) {
 		reset();
 	}
 	else {
+		windowPositionsSize = windowPositionsMask = samplesSize = samplesMask = samplesCapacity = 0;
 		samples = NULL;
 		windowPositions = NULL;
 	}
@@ -119,15 +228,90 @@ bool Synthesizer::setBufferSize(int bufferSize) {
 	return true;
 	
 	alloc_failed:
-	windowPositionsSize = samplesSize = 0;
+	windowPositionsSize = windowPositionsMask = samplesSize = samplesMask = samplesCapacity = 0;
 	samples = NULL;
 	windowPositions = NULL;
 	return false;
 }
 
+void Synthesizer::setRampTime(float seconds) {
+	aOffset.setTime(seconds);
+	aGain.setTime(seconds);
+	fOffset.setTime(seconds);
+	fGain.setTime(seconds);
+}
+
 void Synthesizer::setOversamplingMultiplier(int multiplier) {
 	oversamplingMultiplier = multiplier;
 	oversamplingMultiplierF = (float) multiplier;
+	selectDecimationFilter();
+}
+
+void Synthesizer::setDecimationFilter(DecimationFilter filter) {
+	decimationFilter = filter;
+	selectDecimationFilter();
+}
+
+void Synthesizer::selectDecimationFilter() {
+	const float *filter = (oversamplingMultiplier > 1)
+	                      ? getDecimationFilters().filters[decimationFilter][oversamplingMultiplier]
+	                      : NULL;
+	
+	if (filter == decimCoefficients)
+		return;
+	
+	int oldHistory = decimTaps - 1, oldMultiplier = decimMultiplier;
+	
+	decimCoefficients = filter;
+	decimTaps = (filter != NULL) ? decimTapsPerPhase[decimationFilter]*oversamplingMultiplier : 0;
+	decimMultiplier = oversamplingMultiplier;
+	
+	if (decimTaps > 0)
+		resampleDecimatorHistory(oldHistory, oldMultiplier);
+}
+
+// The history the old filter left holds points at the old rate. It's resampled to the new
+// rate, so the new filter carries on from the same waveform instead of from silence or from
+// points at the wrong spacing. Box averaging keeps no history, so the newest point it fetched
+// is held instead. Where the new filter reaches further back than the old history, the
+// oldest point is held.
+void Synthesizer::resampleDecimatorHistory(int oldHistory, int oldMultiplier) {
+	int history = decimTaps - 1;
+	
+	if (oldHistory <= 0) {
+		std::fill(pointBuffer, pointBuffer + history, lastPoint);
+		return;
+	}
+	
+	float old[WP_SYN_MAX_DECIM_TAPS];
+	float step = (float) oldMultiplier / oversamplingMultiplier;
+	
+	std::memcpy(old, pointBuffer, oldHistory * sizeof (float));
+	
+	for (int k = 0; k < history; k++) {
+		float pos = (oldHistory - 1) - (history - 1 - k)*step;
+		
+		if (pos <= 0.0f)
+			pointBuffer[k] = old[0];
+		else {
+			int i = (int) pos;
+			float w = pos - i;
+			pointBuffer[k] = old[i] + w*(old[std::min(i + 1, oldHistory - 1)] - old[i]);
+		}
+	}
+}
+
+bool Synthesizer::setBandLimited(bool onOff) {
+	if (onOff && !wavetable.allocate()) {
+		bandLimited = false;
+		return false;
+	}
+	
+	if (!onOff)
+		wavetable.release();
+	
+	bandLimited = onOff;
+	return true;
 }
 
 void Synthesizer::setSmoothingWindow(int smooWin) {
@@ -135,16 +319,49 @@ void Synthesizer::setSmoothingWindow(int smooWin) {
 	reset();
 }
 
+void Synthesizer::render(float *out, int n) {
+	while (n > 0) {
+		// Copy up to and including the last sample before the next fill.
+		// The mirror keeps the span contiguous.
+		int span = std::min(n, SAMPLEINDEX(last - start) + 1);
+		
+		std::memcpy(out, samples + start, span * sizeof (float));
+		out += span;
+		n -= span;
+		
+		start = SAMPLEINC(start + span - 1);
+		if (start == last)
+			fillBuffer();
+		start = SAMPLEINC(start+1);
+	}
+	
+	audioFunc.setValue(samples + start);
+}
+
 void Synthesizer::fillBuffer() {
-	aValue = clamp01(aGain*inA->getValue() + aOffset);
-	fValue = clamp01(fGain*inF->getValue() + fOffset);
+	WP_PROFILE_PROBE(kProbeFillBuffer);
+	
+	// Move the parameter ramps past the samples generated since the last call.
+	if (rampSamples > 0) {
+		aOffset.advance(rampSamples);
+		aGain.advance(rampSamples);
+		fOffset.advance(rampSamples);
+		fGain.advance(rampSamples);
+		inA->advanceMix(rampSamples);
+		inF->advanceMix(rampSamples);
+		inW->advanceMix(rampSamples);
+		rampSamples = 0;
+	}
+	
+	aValue = clamp01(aGain.getValue()*inA->getValue() + aOffset.getValue());
+	fValue = clamp01(fGain.getValue()*inF->getValue() + fOffset.getValue());
 	
 	if (nWindows == 0)
 		loadCycle(aValue, fValue);
 	else {
 		int samplesTotal = SAMPLEINDEX(end-1 - windowPositions[startWin]);
 		
-		while (samplesTotal < windowSize && end != start)
+		while (samplesTotal < windowSize && getFreeSamples() > 0)
 			samplesTotal += loadCycle(aValue, fValue);
 		
 		if (samplesTotal >= windowSize)
@@ -154,7 +371,16 @@ void Synthesizer::fillBuffer() {
 		nWindows--;
 	}
 	
-	last = SAMPLEINDEX((nWindows > 0) ? windowPositions[startWin] - windowSize : end-1);
+	if (nWindows == 0)
+		last = SAMPLEINDEX(end-1);
+	else if (SAMPLEINDEX(windowPositions[startWin] - start) > windowSize)
+		last = SAMPLEINDEX(windowPositions[startWin] - windowSize);
+	else {
+		// The next window reaches back past the sample being played. Play one more sample and
+		// smooth what's left of it on the next fill, rather than letting last fall behind start,
+		// which would replay the whole ring.
+		last = SAMPLEINC(start+1);
+	}
 }
 
 // At least one new sample MUST be stored and the new end of data MUST also be stored.
@@ -167,13 +393,11 @@ int Synthesizer::loadCycle(float a, float f) {
 	sampleFraction = std::modf(nSamplesF, &nSamplesF); // Isolate and store fractional sample.
 	
 	int nSamplesI = (int) nSamplesF;
-	if (nSamplesI > SAMPLEINDEX(start - end)) // Not enough room in output buffer.
-		nSamplesF = nSamplesI = SAMPLEINDEX(start - end);
+	if (nSamplesI > getFreeSamples()) // Not enough room in output buffer.
+		nSamplesF = nSamplesI = getFreeSamples();
 	
-	nSamplesF *= oversamplingMultiplierF;
-	
-	// Tell the waveform modulator how many samples we'll fetch.
-	inW->setCycleSize(nSamplesF);
+	// The new samples are written contiguously from end and then mirrored.
+	float *out = samples + end;
 	
 	/*
 		NOTE: High CPU load when inputs were silent was caused by the Analyzer's
@@ -182,48 +406,154 @@ int Synthesizer::loadCycle(float a, float f) {
 		usually be much slower than pure hardware operations.
 	*/
 	// Fetch and generate samples.
-	int lastEnd = SAMPLEINC(end + nSamplesI);
-	float x = -1.0f, d = 2.0f/nSamplesF;
-	a /= oversamplingMultiplierF;
-	
-	while (end != lastEnd) {
-		float s = 0.0f;
+	if (bandLimited) {
+		// One interpolated lookup per sample in the table for this cycle length.
+		// The table size is a power of 2, so the high bits of the phase are the index
+		// and the rest the weight.
+		int log2Size;
+		const float *pongTable;
+		const float *table = wavetable.getTable(inW, nSamplesI, log2Size, pongTable);
+		unsigned int phase = 0, phaseIncrement = cyclePhaseIncrement(nSamplesF);
 		
-		for (int j = 0; j < oversamplingMultiplier; j++) {
-			s += inW->getValue(x);
-			x += d;
+		if (pongTable != NULL) {
+			// The LFO is held at its value at the start of the cycle.
+			float lfo = inW->getLFOValue();
+			
+			for (int i = 0; i < nSamplesI; i++) {
+				unsigned int index = phase >> (32 - log2Size);
+				float weight = (float) ((phase << log2Size) >> 8) * (1.0f / 16777216.0f);
+				float v0 = table[index] + weight*(table[index+1] - table[index]),
+				      v1 = pongTable[index] + weight*(pongTable[index+1] - pongTable[index]);
+				
+				out[i] = a * (v0 + lfo*(v1 - v0));
+				phase += phaseIncrement;
+			}
+		}
+		else {
+			for (int i = 0; i < nSamplesI; i++) {
+				unsigned int index = phase >> (32 - log2Size);
+				float weight = (float) ((phase << log2Size) >> 8) * (1.0f / 16777216.0f);
+				
+				out[i] = a * (table[index] + weight*(table[index+1] - table[index]));
+				phase += phaseIncrement;
+			}
 		}
 		
-		samples[end] = a * s;
-		end = SAMPLEINC(end+1);
+		// The tables are snapshots, so the LFO is moved by the length of the cycle here.
+		inW->advanceLFO(nSamplesI);
+	}
+	else {
+		// Tell the waveform modulator how many samples we'll fetch.
+		inW->setCycleSize(nSamplesF * oversamplingMultiplierF);
+		
+		if (decimTaps > 0)
+			fetchDecimated(out, a, nSamplesI);
+		else
+			fetchOversampled(out, a / oversamplingMultiplierF, nSamplesI);
 	}
 	
+	mirrorSamples(end, nSamplesI);
+	end = SAMPLEINC(end + nSamplesI);
+	
 	if (windowSize > 0) {
 		windowPositions[endWin] = SAMPLEINDEX(end-1);
 		endWin = WINDOWINC(endWin+1);
 		nWindows++;
 	}
 	
+	rampSamples += nSamplesI;
 	return nSamplesI;
 }
 
+// Fetches oversamplingMultiplier waveform points per sample and stores
+// their sum times a in out[0] to out[nSamples-1].
+void Synthesizer::fetchOversampled(float *out, float a, int nSamples) {
+	for (int nLeft = nSamples; nLeft > 0;) {
+		int n = std::min(nLeft, WP_SYN_POINT_BUFFER_SIZE / oversamplingMultiplier);
+		const float *point = pointBuffer;
+		
+		inW->renderCycle(pointBuffer, n*oversamplingMultiplier);
+		
+		for (int i = 0; i < n; i++) {
+			float s = 0.0f;
+			
+			for (int j = 0; j < oversamplingMultiplier; j++)
+				s += *point++;
+			
+			*out++ = a * s;
+		}
+		
+		lastPoint = point[-1];
+		nLeft -= n;
+	}
+}
+
+// Fetches oversamplingMultiplier waveform points per sample and stores the lowpass
+// filtered point stream times a, taken at every oversamplingMultiplier-th point,
+// in out[0] to out[nSamples-1]. Only the kept outputs of the filter are computed.
+void Synthesizer::fetchDecimated(float *out, float a, int nSamples) {
+	const int history = decimTaps - 1;
+	float *points = pointBuffer + history;
+	
+	for (int nLeft = nSamples; nLeft > 0;) {
+		int n = std::min(nLeft, WP_SYN_POINT_BUFFER_SIZE / oversamplingMultiplier);
+		int nPoints = n*oversamplingMultiplier;
+		
+		inW->renderCycle(points, nPoints);
+		
+		// The newest point of the group for sample i is at points + (i+1)*oversamplingMultiplier - 1
+		// and the filter reaches decimTaps - 1 points further back. The filter is symmetric,
+		// so it doesn't have to be reversed.
+		const float *x = pointBuffer + oversamplingMultiplier - 1;
+		
+		for (int i = 0; i < n; i++) {
+			// decimTaps is a multiple of 8. Four partial sums let the loop run in SIMD registers.
+			float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+			
+			for (int k = 0; k < decimTaps; k += 4) {
+				s0 += decimCoefficients[k] * x[k];
+				s1 += decimCoefficients[k+1] * x[k+1];
+				s2 += decimCoefficients[k+2] * x[k+2];
+				s3 += decimCoefficients[k+3] * x[k+3];
+			}
+			
+			*out++ = a * ((s0 + s1) + (s2 + s3));
+			x += oversamplingMultiplier;
+		}
+		
+		// Keep the newest points as history for the next fetch.
+		std::memmove(pointBuffer, pointBuffer + nPoints, history * sizeof (float));
+		
+		nLeft -= n;
+	}
+}
+
+void Synthesizer::mirrorSamples(int pos, int n) {
+	int nLow = std::min(n, samplesSize - pos);
+	
+	// Samples written in the first half go to the second and any that ran past it go back.
+	std::memcpy(samples + samplesSize + pos, samples + pos, nLow * sizeof (float));
+	std::memcpy(samples, samples + samplesSize, (n - nLow) * sizeof (float));
+}
+
 void Synthesizer::applySmoothing(int windowPos) {
-	float s0 = samples[SAMPLEINDEX(windowPos-1)],
-	      s1 = samples[windowPos],
-	      s2 = samples[SAMPLEINC(windowPos+1)],
-	      s3 = samples[SAMPLEINC(windowPos+2)];
+	// The window spans windowSize samples on each side of the cycle boundary after windowPos.
+	// Work on a contiguous span starting in the first half and mirror it afterwards.
+	int spanStart = SAMPLEINDEX(windowPos+1 - windowSize);
+	float *boundary = samples + spanStart + windowSize - 1;
+	
+	float s0 = boundary[-1],
+	      s1 = boundary[0],
+	      s2 = boundary[1],
+	      s3 = boundary[2];
 	
 	float lDiff = s1 - s0, eDiff = s2 - s1, rDiff = s3 - s2;
 	float delta0 = 0.5f * (eDiff - 0.5f*(rDiff + lDiff)),
 	      delta1 = -0.5f * (rDiff - lDiff);
 	
-	float mL = delta0, mR = -delta0;
+	// The offset i steps from the boundary is fade(i)*(delta0 + i*delta1) on the left and
+	// fade(i)*(i*delta1 - delta0) on the right.
+	addScaledTables(samples + spanStart, 2 * windowSize, fadeShape, fadeRamp, delta0, delta1);
 	
-	for (int i = 0; i < windowSize; i++) {
-		samples[SAMPLEINDEX(windowPos - i)] += fadeBuffer[i]*mL;
-		samples[SAMPLEINC(windowPos+1 + i)] += fadeBuffer[i]*mR;
-		
-		mL += delta1;
-		mR += delta1;
-	}
+	mirrorSamples(spanStart, 2 * windowSize);
 }
@@ -24,8 +24,29 @@ DEALINGS IN THE SOFTWARE.
 #include "wpfunc.hpp"
 #include "BufferManager.hpp"
 #include "wpmodulators.hpp"
+#include "Wavetable.hpp"
 
-#define SAMPLEINC(x) ((x) % samplesSize)
+// The sample ring size is a power of 2, so indices wrap with a mask. This also wraps negative
+// offsets in two's complement.
+#define SAMPLEINC(x) ((x) & samplesMask)
+
+// Number of waveform points loadCycle fetches from the waveform modulator at a time.
+#define WP_SYN_POINT_BUFFER_SIZE 256
+
+// Longest decimation filter: 32 taps per phase at the highest oversampling multiplier.
+#define WP_SYN_MAX_DECIM_TAPS (32*16)
+
+// How oversampled waveform points are reduced to samples.
+enum DecimationFilter {
+	kDecimBox,    // Average of each group of points.
+	kDecimLow,    // Kaiser windowed sinc lowpass, 8 taps per phase.
+	kDecimMedium, // 16 taps per phase.
+	kDecimHigh,   // 32 taps per phase.
+	
+	kNumDecimFilters
+};
+
+extern const char *const decimationFilterNames[kNumDecimFilters];
 
 class Synthesizer {
 private:
@@ -36,14 +57,40 @@ private:
 	UnsignedModulator *inA, *inF;
 	FunctionModulator *inW;
 	
-	float aOffset, aGain, fOffset, fGain;
+	ParameterRamp aOffset, aGain, fOffset, fGain;
 	int oversamplingMultiplier, smoothingWindow;
+	bool bandLimited;
+	
+	// Polyphase decimator. decimTaps is 0 and decimCoefficients NULL when the points are box
+	// averaged. The filters are shared by all synthesizers. decimMultiplier is the multiplier
+	// the filter was selected for, and lastPoint the newest point fetched by box averaging.
+	DecimationFilter decimationFilter;
+	int decimTaps, decimMultiplier;
+	const float *decimCoefficients;
+	float lastPoint;
+	
+	// Band-limited tables for the waveform input. Only allocated in band-limited mode.
+	Wavetable wavetable;
+	
+	// Samples generated since the parameter ramps were last moved.
+	int rampSamples;
 	
+	// samples holds 2*samplesSize samples. The second half mirrors the first, so any span of up
+	// to samplesSize samples starting in the first half can be read and written contiguously.
+	// Only samplesCapacity samples of the ring are used; it's the requested buffer size.
 	float *samples;
 	int *windowPositions;
-	float *fadeBuffer;
 	
-	int samplesSize, windowPositionsSize, windowSize,
+	// Smoothing tables, 2*windowSize samples each, laid out like the span applySmoothing
+	// works on. fadeShape holds the fade curve, negated right of the boundary, and fadeRamp
+	// the fade curve times the distance from the boundary.
+	float *fadeBuffer, *fadeShape, *fadeRamp;
+	
+	// The last decimTaps - 1 points of the previous fetch followed by the points being decimated.
+	float pointBuffer[WP_SYN_MAX_DECIM_TAPS - 1 + WP_SYN_POINT_BUFFER_SIZE];
+	
+	int samplesSize, samplesMask, samplesCapacity,
+	    windowPositionsSize, windowPositionsMask, windowSize,
 	    start, last, end, startWin, endWin, nWindows;
 	float aValue, fValue, oversamplingMultiplierF, sampleFraction;
 	
@@ -60,23 +107,43 @@ public:
 	
 	RealFunction *getAudioFunction() {return &audioFunc;}
 	
-	int getBufferSize() {return samplesSize;}
+	int getBufferSize() {return samplesCapacity;}
 	bool setBufferSize(int bufferSize);
 	
-	float getAOffset() {return aOffset;}
-	float getAGain() {return aGain;}
-	float getFOffset() {return fOffset;}
-	float getFGain() {return fGain;}
+	float getAOffset() {return aOffset.getTarget();}
+	float getAGain() {return aGain.getTarget();}
+	float getFOffset() {return fOffset.getTarget();}
+	float getFGain() {return fGain.getTarget();}
 	int getOversamplingMultiplier() {return oversamplingMultiplier;}
 	int getSmoothingWindow() {return smoothingWindow;}
+	bool getBandLimited() {return bandLimited;}
+	DecimationFilter getDecimationFilter() {return decimationFilter;}
+	
+	// Offset and gain changes are ramped over this time. The amplitude and frequency
+	// are computed once per cycle, so the ramps move in steps of one cycle.
+	float getRampTime() {return aGain.getTime();}
+	void setRampTime(float seconds);
 	
-	void setAOffset(float offset) {aOffset = offset;}
-	void setAGain(float gain) {aGain = gain;}
-	void setFOffset(float offset) {fOffset = offset;}
-	void setFGain(float gain) {fGain = gain;}
+	void setAOffset(float offset) {aOffset.setTarget(offset);}
+	void setAGain(float gain) {aGain.setTarget(gain);}
+	void setFOffset(float offset) {fOffset.setTarget(offset);}
+	void setFGain(float gain) {fGain.setTarget(gain);}
 	void setOversamplingMultiplier(int multiplier);
 	void setSmoothingWindow(int smooWin);
 	
+	// In band-limited mode each cycle is played from a band-limited table of the waveform
+	// input instead of being fetched with oversampling. The oversampling multiplier is
+	// ignored. Returns false if the tables couldn't be allocated.
+	bool setBandLimited(bool onOff);
+	
+	// The lowpass filters of the polyphase decimator cut off at the output Nyquist frequency,
+	// so 2x or 4x oversampling rejects aliases better than 16x with box averaging.
+	// They delay the waveform by about half their length (4 to 16 samples) relative to the
+	// cycle boundaries. Without oversampling the filter setting has no effect.
+	// Multiplier changes carry the filter history over, so they don't click, but switching
+	// between box averaging and a filter (or to no oversampling) moves the waveform by the delay.
+	void setDecimationFilter(DecimationFilter filter);
+	
 	void tick() {
 		if (start == last)
 			fillBuffer();
@@ -84,12 +151,31 @@ public:
 		audioFunc.setValue(samples + start);
 	}
 	
+	// Same as reading the audio function and calling tick() n times, storing the values in out.
+	void render(float *out, int n);
+	
+	// Number of ticks that can be made before the analyzers must be up to date.
+	// Only the last of these ticks may call fillBuffer.
+	int getTicksBeforeFill() {return SAMPLEINC(last - start) + 1;}
+	
 	float getAmplitude() {return aValue;}
 	float getFrequency() {return fValue;}
 	
 private:
 	void fillBuffer();
 	int loadCycle(float a, float f);
+	void fetchOversampled(float *out, float a, int nSamples);
+	void fetchDecimated(float *out, float a, int nSamples);
+	
+	// Number of samples that can be stored before the buffer holds samplesCapacity samples.
+	// The sample at start is still in use.
+	int getFreeSamples() {return samplesCapacity - (SAMPLEINC(end - start - 1) + 1);}
+	
+	// Copies the n samples written at samples + pos to their mirror images. pos must be in
+	// the first half and n at most samplesSize.
+	void mirrorSamples(int pos, int n);
+	void selectDecimationFilter();
+	void resampleDecimatorHistory(int oldHistory, int oldMultiplier);
 	void applySmoothing(int windowPos);
 };
 
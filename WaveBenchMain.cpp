@@ -0,0 +1,601 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "wpstdinclude.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "WaveEngine.hpp"
+#include "WaveEngineBatch.hpp"
+#include "wpfpu.hpp"
+#include "wpkernels.hpp"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define WB_HAVE_CYCLE_COUNTER
+#endif
+
+// Microbenchmarks for the processing components, in the style of Google Benchmark.
+// Each benchmark sets up its components, runs its loop state.iterations times between
+// state.startTiming() and state.stopTiming(), and reports how many samples that was. Only the
+// loop is timed.
+// The runner doubles the iteration count until a run takes at least the minimum time, then
+// reports the fastest of a few runs in nanoseconds and CPU cycles per sample.
+// NOTE: Cycles are time stamp counter ticks. On most current x86 CPUs the counter runs at
+// the nominal clock rate regardless of the actual clock rate.
+
+#define WB_SIGNAL_SIZE 65536 // Test signal length. Power of 2.
+#define WB_BLOCK_SIZE 256
+#define WB_REPETITIONS 3
+
+typedef std::chrono::steady_clock benchclock;
+
+static unsigned long long readCycleCounter() {
+#ifdef WB_HAVE_CYCLE_COUNTER
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+struct BenchState {
+	long iterations;
+	long samples; // Set by the benchmark.
+	
+	// Time and cycle counter ticks from startTiming to stopTiming.
+	double seconds;
+	unsigned long long cycles;
+	
+	benchclock::time_point t0;
+	unsigned long long c0;
+	
+	void startTiming() {
+		t0 = benchclock::now();
+		c0 = readCycleCounter();
+	}
+	
+	void stopTiming() {
+		cycles = readCycleCounter() - c0;
+		seconds = std::chrono::duration<double>(benchclock::now() - t0).count();
+	}
+};
+
+typedef void (*benchfunc)(BenchState &, int);
+
+struct Benchmark {
+	std::string name;
+	benchfunc func;
+	int arg;
+};
+
+// Sink for results so the compiler can't drop the benchmarked work.
+static volatile float sink;
+
+
+// ---<<< Test signals >>>---
+enum {kSignalSilent, kSignalSine, kSignalNoise, kSignalBass, kSignalDenormal, kNumSignals};
+
+static const char *const signalNames[kNumSignals] = {"silent", "sine", "noise", "bass", "denormal"};
+
+static std::vector<float> signals[kNumSignals];
+
+static void makeSignals() {
+	unsigned int seed = 1;
+	
+	for (int s = 0; s < kNumSignals; s++)
+		signals[s].resize(WB_SIGNAL_SIZE);
+	
+	for (int i = 0; i < WB_SIGNAL_SIZE; i++) {
+		float t = i / WP_STD_SAMPLE_RATE;
+		
+		seed = seed*1664525u + 1013904223u;
+		
+		signals[kSignalSilent][i] = 0.0f;
+		signals[kSignalSine][i] = 0.5f*std::sin(6.2831853f*440.0f*t);
+		signals[kSignalNoise][i] = (seed >> 8) / 16777216.0f - 0.5f;
+		signals[kSignalBass][i] =
+			0.6f*std::sin(6.2831853f*41.2f*t) + 0.2f*std::sin(6.2831853f*82.4f*t + 0.5f) +
+			0.1f*std::sin(6.2831853f*123.6f*t + 1.0f);
+		
+		// Noise below the smallest normal float (1.2e-38), like the end of a decaying tail.
+		signals[kSignalDenormal][i] = signals[kSignalNoise][i] * 1.0e-38f;
+	}
+}
+
+// Sets the initial plugin parameter values in an analyzer, like WaveEngine does.
+static void initAnalyzer(Analyzer &ana, BufferManager &bMan) {
+	const float *v = WaveEngine::initParamValues;
+	
+	ana.initialize(&bMan, 4 * WP_ANA_BUFFER_SIZE);
+	ana.setIncrementalUpdates(true);
+	ana.setAIncWeight(INC_LAG_T(v[kAIncLag]));
+	ana.setADecWeight(DEC_LAG_T(v[kADecLag]));
+	ana.setAmpGateLevel(A_GATE_LVL_T(v[kGateLvlA]));
+	ana.setSampleGateLevel(S_GATE_LVL_T(v[kGateLvlS]));
+	ana.setHighTrig(TRIG_LVL_T(v[kHighTrig]));
+	ana.setLowTrig(TRIG_LVL_T(v[kLowTrig]));
+	ana.setFMin(F_MIN_T(v[kFMin]));
+	ana.setFMax(F_MAX_T(v[kFMax]));
+	ana.setFWeight(F_LAG_T(v[kFLag]));
+	ana.setWWeight(W_LAG_T(v[kWLag]));
+	ana.setTrigInverted(BOOL_T(v[kInvTrig]));
+	ana.setWInterpolation(BOOL_T(v[kInterp]));
+}
+
+// Sine and saw cycles for the waveform inputs. The last sample repeats the first.
+static float sineCycle[WB_BLOCK_SIZE + 1], sawCycle[WB_BLOCK_SIZE + 1];
+
+static void makeCycles(FunctionFunction &sine, FunctionFunction &saw) {
+	for (int i = 0; i <= WB_BLOCK_SIZE; i++) {
+		sineCycle[i] = 0.8f*std::sin(6.2831853f*i / WB_BLOCK_SIZE);
+		sawCycle[i] = 1.6f*((i % WB_BLOCK_SIZE) / (float) WB_BLOCK_SIZE) - 0.8f;
+	}
+	
+	sine.setFunction(WB_BLOCK_SIZE + 1, sineCycle);
+	saw.setFunction(WB_BLOCK_SIZE + 1, sawCycle);
+	sine.setInterpolation(true);
+	saw.setInterpolation(true);
+}
+
+
+// ---<<< Benchmarks >>>---
+static void benchAnalyzerAddSample(BenchState &state, int signal) {
+	BufferManager bMan;
+	Analyzer ana;
+	const float *in = &signals[signal][0];
+	
+	initAnalyzer(ana, bMan);
+	
+	state.startTiming();
+	for (long n = 0; n < state.iterations; n++)
+		ana.addSample(in[n & (WB_SIGNAL_SIZE-1)]);
+	state.stopTiming();
+	
+	sink = ana.getAmplitude();
+	state.samples = state.iterations;
+}
+
+// Bits 8 and up select the trigger mode.
+static void benchAnalyzerProcessBlock(BenchState &state, int arg) {
+	BufferManager bMan;
+	Analyzer ana;
+	const float *in = &signals[arg & 0xff][0];
+	
+	initAnalyzer(ana, bMan);
+	ana.setTriggerMode((TriggerMode) (arg >> 8));
+	
+	state.startTiming();
+	for (long n = 0; n < state.iterations; n++)
+		ana.processBlock(in + (n * WB_BLOCK_SIZE & (WB_SIGNAL_SIZE-1)), WB_BLOCK_SIZE);
+	state.stopTiming();
+	
+	sink = ana.getAmplitude();
+	state.samples = state.iterations * WB_BLOCK_SIZE;
+}
+
+// Renders the synthesizer output, which runs fillBuffer and loadCycle once per cycle.
+// Oversampling 0 selects band-limited mode. Bits 8-15 select the decimation filter
+// and bits 16 and up the smoothing window.
+static void benchSynthesizerRender(BenchState &state, int arg) {
+	int oversampling = arg & 0xff;
+	BufferManager bMan;
+	FunctionFunction sine, saw;
+	float amp = 0.5f, freq = hzToUnsigned(220.0f);
+	RealFunction ampIn(&amp), freqIn(&freq);
+	UnsignedModulator modA, modF;
+	FunctionModulator modW;
+	Synthesizer syn;
+	float out[WB_BLOCK_SIZE];
+	
+	makeCycles(sine, saw);
+	modA.initialize(&ampIn, &ampIn);
+	modF.initialize(&freqIn, &freqIn);
+	modW.initialize(&sine, &saw);
+	modW.setMix(0.5f);
+	syn.initialize(&bMan, &modA, &modF, &modW, 4 * WP_SYN_BUFFER_SIZE);
+	if (oversampling > 0) {
+		syn.setOversamplingMultiplier(oversampling);
+		syn.setDecimationFilter((DecimationFilter) (arg >> 8));
+	}
+	else
+		syn.setBandLimited(true);
+	syn.setSmoothingWindow(arg >> 16);
+	
+	state.startTiming();
+	for (long n = 0; n < state.iterations; n++) {
+		syn.render(out, WB_BLOCK_SIZE);
+		freq = hzToUnsigned(220.0f + (n & 63)); // Vary the cycle length.
+	}
+	state.stopTiming();
+	
+	sink = out[0];
+	state.samples = state.iterations * WB_BLOCK_SIZE;
+}
+
+static void benchFunctionFunction(BenchState &state, int mode) {
+	FunctionFunction sine, saw;
+	float acc = 0.0f;
+	
+	makeCycles(sine, saw);
+	sine.setInterpolationMode((InterpolationMode) mode);
+	
+	state.startTiming();
+	for (long n = 0; n < state.iterations; n++)
+		acc += sine.getValue((n % 1000) * 0.002f - 1.0f);
+	state.stopTiming();
+	
+	sink = acc;
+	state.samples = state.iterations;
+}
+
+static void benchUnsignedModulator(BenchState &state, int modType) {
+	const float *in = &signals[kSignalSine][0];
+	float v1 = 0.0f, v2 = 0.0f, acc = 0.0f;
+	RealFunction in1(&v1), in2(&v2);
+	UnsignedModulator mod;
+	
+	mod.initialize(&in1, &in2);
+	mod.setModulation((ModulationTypeU) modType);
+	mod.setMix(0.5f);
+	
+	state.startTiming();
+	for (long n = 0; n < state.iterations; n++) {
+		v1 = 0.5f + in[n & (WB_SIGNAL_SIZE-1)];
+		v2 = 0.5f + in[(n + 100) & (WB_SIGNAL_SIZE-1)];
+		acc += mod.getValue();
+	}
+	state.stopTiming();
+	
+	sink = acc;
+	state.samples = state.iterations;
+}
+
+static void benchSignedModulator(BenchState &state, int modType) {
+	const float *in = &signals[kSignalSine][0], *in2 = &signals[kSignalNoise][0];
+	float out[WB_BLOCK_SIZE];
+	SignedModulator mod;
+	
+	mod.initialize();
+	mod.setModulation((ModulationTypeS) modType);
+	mod.setMix(0.5f);
+	
+	state.startTiming();
+	for (long n = 0; n < state.iterations; n++) {
+		int pos = n * WB_BLOCK_SIZE & (WB_SIGNAL_SIZE-1);
+		mod.processBlock(in + pos, in2 + pos, out, WB_BLOCK_SIZE);
+	}
+	state.stopTiming();
+	
+	sink = out[0];
+	state.samples = state.iterations * WB_BLOCK_SIZE;
+}
+
+static void benchFunctionModulator(BenchState &state, int modType) {
+	FunctionFunction sine, saw;
+	FunctionModulator mod;
+	float acc = 0.0f;
+	
+	makeCycles(sine, saw);
+	mod.initialize(&sine, &saw);
+	mod.setModulation((ModulationTypeF) modType);
+	mod.setMix(0.5f);
+	
+	state.startTiming();
+	// One setCycleSize call per cycle of 200 points, like the synthesizer.
+	for (long n = 0; n < state.iterations; n++) {
+		if (n % 200 == 0)
+			mod.setCycleSize(200.0f);
+		acc += mod.getValue((n % 200) * 0.01f - 1.0f);
+	}
+	state.stopTiming();
+	
+	sink = acc;
+	state.samples = state.iterations;
+}
+
+// The plugin's two input, two output replacing path with initial parameter values.
+// The second input is the same signal delayed. Bit 8 of arg turns on flush-to-zero and
+// denormals-are-zero, like WavePlug::processReplacing does, and bit 9 turns off silence
+// skipping. Bit 10 turns on band-limited synthesis and bit 11 16x oversampling.
+static void benchEngine(BenchState &state, int arg) {
+	int signal = arg & 0xff;
+	WaveEngine *engine = new WaveEngine();
+	std::vector<float> out(2 * WB_BLOCK_SIZE);
+	float *in0 = &signals[signal][0], *in1 = &signals[signal][WB_SIGNAL_SIZE/2];
+	
+	engine->initialize();
+	for (int i = 0; i < kNumAllParams; i++)
+		engine->setParameter(i, WaveEngine::getInitParamValue(i));
+	if (arg & 0x800) {
+		engine->setParameter(kNumMonoParams + kOversmpl, 1.0f);
+		engine->setParameter(kNumMonoParams + kNumParams + kOversmpl, 1.0f);
+	}
+	if (arg & 0x400)
+		engine->setBandLimited(true);
+	engine->setProcessMode(true, true, false);
+	engine->setSkipSilence(!(arg & 0x200));
+	
+	state.startTiming();
+	for (long n = 0; n < state.iterations; n++) {
+		int pos = n * WB_BLOCK_SIZE & (WB_SIGNAL_SIZE/2 - 1);
+		
+		if (arg & 0x100) {
+			DenormalGuard denormalGuard;
+			engine->processReplacing(in0 + pos, in1 + pos, &out[0], &out[WB_BLOCK_SIZE], WB_BLOCK_SIZE);
+		}
+		else
+			engine->processReplacing(in0 + pos, in1 + pos, &out[0], &out[WB_BLOCK_SIZE], WB_BLOCK_SIZE);
+	}
+	state.stopTiming();
+	
+	sink = out[0];
+	state.samples = state.iterations * WB_BLOCK_SIZE;
+	delete engine;
+}
+
+// WB_INSTANCES engines, each reading the signal at its own offset, processed one after the
+// other or (bit 8 of arg) with a WaveEngineBatch. Samples are counted per engine.
+#define WB_INSTANCES 16
+
+static void benchEngines(BenchState &state, int arg) {
+	int signal = arg & 0xff;
+	WaveEngine *engines[WB_INSTANCES];
+	WaveEngineBatch *batch = new WaveEngineBatch();
+	std::vector<float> out(2 * WB_INSTANCES * WB_BLOCK_SIZE);
+	float *in0[WB_INSTANCES], *in1[WB_INSTANCES], *out0[WB_INSTANCES], *out1[WB_INSTANCES];
+	
+	for (int k = 0; k < WB_INSTANCES; k++) {
+		engines[k] = new WaveEngine();
+		engines[k]->initialize();
+		for (int i = 0; i < kNumAllParams; i++)
+			engines[k]->setParameter(i, WaveEngine::getInitParamValue(i));
+		engines[k]->setProcessMode(true, true, false);
+		
+		out0[k] = &out[2*k * WB_BLOCK_SIZE];
+		out1[k] = out0[k] + WB_BLOCK_SIZE;
+	}
+	batch->setEngines(engines, WB_INSTANCES);
+	
+	state.startTiming();
+	for (long n = 0; n < state.iterations; n++) {
+		for (int k = 0; k < WB_INSTANCES; k++) {
+			int pos = (n * WB_BLOCK_SIZE + k*997) & (WB_SIGNAL_SIZE/2 - 1);
+			in0[k] = &signals[signal][pos];
+			in1[k] = in0[k] + WB_SIGNAL_SIZE/2;
+		}
+		
+		if (arg & 0x100)
+			batch->processReplacing(in0, in1, out0, out1, WB_BLOCK_SIZE);
+		else {
+			for (int k = 0; k < WB_INSTANCES; k++)
+				engines[k]->processReplacing(in0[k], in1[k], out0[k], out1[k], WB_BLOCK_SIZE);
+		}
+	}
+	state.stopTiming();
+	
+	sink = out[0];
+	state.samples = state.iterations * WB_BLOCK_SIZE * WB_INSTANCES;
+	delete batch;
+	for (int k = 0; k < WB_INSTANCES; k++)
+		delete engines[k];
+}
+
+static std::vector<Benchmark> registerBenchmarks() {
+	std::vector<Benchmark> benchmarks;
+	Benchmark b;
+	
+	for (int s = 0; s < kNumSignals; s++) {
+		b.func = benchAnalyzerAddSample; b.arg = s;
+		b.name = std::string("Analyzer/addSample/") + signalNames[s];
+		benchmarks.push_back(b);
+	}
+	
+	for (int s = 0; s < kNumSignals; s++) {
+		b.func = benchAnalyzerProcessBlock; b.arg = s;
+		b.name = std::string("Analyzer/processBlock/") + signalNames[s];
+		benchmarks.push_back(b);
+	}
+	
+	for (int s = 0; s < kNumSignals; s++) {
+		b.func = benchAnalyzerProcessBlock; b.arg = kTriggerYin << 8 | s;
+		b.name = std::string("Analyzer/processBlock/yin:") + signalNames[s];
+		benchmarks.push_back(b);
+	}
+	
+	for (int m = 1; m <= 16; m++) {
+		char name[64];
+		std::sprintf(name, "Synthesizer/render/oversampling:%d", m);
+		b.func = benchSynthesizerRender; b.arg = m; b.name = name;
+		benchmarks.push_back(b);
+	}
+	
+	for (int d = kDecimLow; d < kNumDecimFilters; d++) {
+		for (int m = 2; m <= 4; m *= 2) {
+			char name[64];
+			std::sprintf(name, "Synthesizer/render/decimation:%s/oversampling:%d", decimationFilterNames[d], m);
+			b.func = benchSynthesizerRender; b.arg = d << 8 | m; b.name = name;
+			benchmarks.push_back(b);
+		}
+	}
+	
+	b.func = benchSynthesizerRender; b.arg = 0; b.name = "Synthesizer/render/bandlimited";
+	benchmarks.push_back(b);
+	
+	for (int w = 25; w <= 250; w *= 10) {
+		char name[64];
+		std::sprintf(name, "Synthesizer/render/smoothing:%d", w);
+		b.func = benchSynthesizerRender; b.arg = w << 16 | 1; b.name = name;
+		benchmarks.push_back(b);
+	}
+	
+	for (int m = 0; m < kNumInterpModes; m++) {
+		b.func = benchFunctionFunction; b.arg = m;
+		b.name = std::string("FunctionFunction/getValue/") + interpolationModeNames[m];
+		benchmarks.push_back(b);
+	}
+	
+	for (int t = 0; t < kNModTypesU; t++) {
+		b.func = benchUnsignedModulator; b.arg = t;
+		b.name = std::string("UnsignedModulator/") + modTypeUNames[t];
+		benchmarks.push_back(b);
+	}
+	
+	for (int t = 0; t < kNModTypesS; t++) {
+		b.func = benchSignedModulator; b.arg = t;
+		b.name = std::string("SignedModulator/processBlock/") + modTypeSNames[t];
+		benchmarks.push_back(b);
+	}
+	
+	for (int t = 0; t < kNModTypesF; t++) {
+		b.func = benchFunctionModulator; b.arg = t;
+		b.name = std::string("FunctionModulator/") + modTypeFNames[t];
+		benchmarks.push_back(b);
+	}
+	
+	for (int s = 0; s < kNumSignals; s++) {
+		b.func = benchEngine; b.arg = s;
+		b.name = std::string("WaveEngine/procR2In2Out/") + signalNames[s];
+		benchmarks.push_back(b);
+	}
+	
+	for (int s = 0; s < kNumSignals; s++) {
+		b.func = benchEngine; b.arg = 0x100 | s;
+		b.name = std::string("WaveEngine/procR2In2Out/ftz:") + signalNames[s];
+		benchmarks.push_back(b);
+	}
+	
+	// Silence skipping also skips denormal input, so the flush-to-zero guard only shows with
+	// skipping off. Sine is the reference.
+	const int noskipSignals[3] = {kSignalSine, kSignalSilent, kSignalDenormal};
+	
+	for (int ftz = 0; ftz < 2; ftz++) {
+		for (int i = 0; i < 3; i++) {
+			b.func = benchEngine; b.arg = 0x200 | ftz << 8 | noskipSignals[i];
+			b.name = std::string("WaveEngine/procR2In2Out/noskip:") + ((ftz) ? "ftz:" : "") +
+			         signalNames[noskipSignals[i]];
+			benchmarks.push_back(b);
+		}
+	}
+	
+	// Band-limited synthesis against the oversampling it replaces, on live input.
+	for (int s = kSignalSine; s <= kSignalBass; s++) {
+		b.func = benchEngine; b.arg = 0x800 | s;
+		b.name = std::string("WaveEngine/procR2In2Out/oversampling16:") + signalNames[s];
+		benchmarks.push_back(b);
+		
+		b.func = benchEngine; b.arg = 0x400 | s;
+		b.name = std::string("WaveEngine/procR2In2Out/bandlimited:") + signalNames[s];
+		benchmarks.push_back(b);
+	}
+	
+	for (int batched = 0; batched < 2; batched++) {
+		for (int s = 0; s < kNumSignals; s++) {
+			char name[64];
+			std::sprintf(
+				name, "%s/procR2In2Out/x%d:%s", (batched) ? "WaveEngineBatch" : "WaveEngine",
+				WB_INSTANCES, signalNames[s]);
+			b.func = benchEngines; b.arg = batched << 8 | s; b.name = name;
+			benchmarks.push_back(b);
+		}
+	}
+	
+	return benchmarks;
+}
+
+
+// ---<<< Runner >>>---
+static void runBenchmark(const Benchmark &b, double minTime) {
+	BenchState state;
+	double bestNs = 0.0, bestCycles = 0.0;
+	
+	// Find an iteration count whose timed loop takes at least minTime.
+	state.iterations = 1;
+	
+	for (;;) {
+		b.func(state, b.arg);
+		
+		if (state.seconds >= minTime || state.iterations >= (1L << 40))
+			break;
+		
+		state.iterations *= (state.seconds > 0.0 && minTime / state.seconds < 2.0) ? 2 : 8;
+	}
+	
+	// Report the fastest of a few runs.
+	for (int r = 0; r < WB_REPETITIONS; r++) {
+		b.func(state, b.arg);
+		
+		double ns = 1.0e9 * state.seconds / state.samples,
+		       cycles = (double) state.cycles / state.samples;
+		
+		if (r == 0 || ns < bestNs) {
+			bestNs = ns;
+			bestCycles = cycles;
+		}
+	}
+	
+#ifdef WB_HAVE_CYCLE_COUNTER
+	std::printf("%-52s %12.3f %14.2f %14ld\n", b.name.c_str(), bestNs, bestCycles, state.samples);
+#else
+	std::printf("%-52s %12.3f %14s %14ld\n", b.name.c_str(), bestNs, "-", state.samples);
+#endif
+	std::fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	double minTime = 0.2;
+	const char *filter = NULL;
+	
+	for (int i = 1; i < argc; i++) {
+		if (!std::strncmp(argv[i], "--min-time=", 11))
+			minTime = std::atof(argv[i] + 11);
+		else if (argv[i][0] != '-' && filter == NULL)
+			filter = argv[i];
+		else {
+			std::fputs(
+				"Usage: LostTechBench [--min-time=SECONDS] [FILTER]\n"
+				"Runs the benchmarks whose names contain FILTER.\n", stderr);
+			return 1;
+		}
+	}
+	
+	makeSignals();
+	
+	std::vector<Benchmark> benchmarks = registerBenchmarks();
+	
+	std::printf("Waveform kernels: %s\n\n", getWaveKernelsName());
+	std::printf("%-52s %12s %14s %14s\n", "Benchmark", "ns/sample", "cycles/sample", "samples");
+	std::printf("%s\n", std::string(95, '-').c_str());
+	
+	for (size_t i = 0; i < benchmarks.size(); i++) {
+		if (filter == NULL || benchmarks[i].name.find(filter) != std::string::npos)
+			runBenchmark(benchmarks[i], minTime);
+	}
+	
+	return 0;
+}
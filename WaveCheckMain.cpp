@@ -0,0 +1,373 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "wpstdinclude.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "WaveEngine.hpp"
+#include "WaveEngineBatch.hpp"
+#include "wpkernels.hpp"
+
+// Checks that the code paths which must give the same results do so, bit for bit:
+// WaveEngineBatch against the same engines processed one by one, and the trackLanes
+// implementations against each other. Prints a line per check and returns 1 if any fails.
+
+#define WC_SIGNAL_SIZE (3 * 44100) // Frames per engine input.
+#define WC_MAX_CHUNK 1000          // Longest process call.
+#define WC_INSTANCES 7             // Engines per batch. Not a multiple of the group size.
+#define WC_LANE_TRIALS 20000
+#define WC_LANE_RECORD_SIZE 256
+
+// Linear congruential generator, so every run checks the same cases.
+struct Random {
+	unsigned int seed;
+	
+	Random(unsigned int s) : seed(s) {}
+	
+	unsigned int next() {
+		seed = seed*1664525u + 1013904223u;
+		return seed >> 8;
+	}
+	
+	// Uniform in [0, 1).
+	float uniform() {return next() / 16777216.0f;}
+	int below(int n) {return (int) (next() % n);}
+};
+
+
+// ---<<< WaveEngineBatch >>>---
+// Sine sweeps, noise, chords and silence in random stretches, so the engines go through
+// triggers, gates and silence skipping at different times.
+static void makeSignal(float *signal, int n, Random &random) {
+	int i = 0;
+	
+	while (i < n) {
+		int kind = random.below(4), end = std::min(n, i + 2000 + random.below(20000));
+		float f = 40.0f + 2000.0f*random.uniform(), level = 0.05f + random.uniform();
+		
+		for (float phase = 0.0f; i < end; i++) {
+			phase += 6.2831853f * f / WP_STD_SAMPLE_RATE;
+			f *= 1.00002f;
+			
+			switch (kind) {
+				case 0:
+				signal[i] = level * std::sin(phase);
+				break;
+				
+				case 1:
+				signal[i] = level * (random.uniform() - 0.5f);
+				break;
+				
+				case 2:
+				signal[i] = level * (0.6f*std::sin(phase) + 0.3f*std::sin(2.01f*phase + 0.5f));
+				break;
+				
+				default:
+				signal[i] = 0.0f;
+			}
+		}
+	}
+}
+
+// Engine k of the check, set up one of a few ways, with some parameters at random values.
+static WaveEngine *makeEngine(int k, bool stereo, unsigned int seed) {
+	WaveEngine *engine = new WaveEngine();
+	Random random(seed);
+	
+	if (!engine->initialize()) {
+		delete engine;
+		return NULL;
+	}
+	
+	for (int i = 0; i < kNumAllParams; i++)
+		engine->setParameter(i, WaveEngine::getInitParamValue(i));
+	for (int i = 0; i < 8; i++)
+		engine->setParameter(kNumMonoParams + random.below(2*kNumParams), random.uniform());
+	
+	engine->setRampTime(0.01f);
+	engine->setProcessMode(stereo && k != 1, stereo && k != 2, k == 3);
+	
+	if (k == 4)
+		engine->setTriggerMode(1, kTriggerYin);
+	if (k == 5)
+		engine->setBandLimited(true);
+	if (k == 6)
+		engine->setSkipSilence(false);
+	
+	return engine;
+}
+
+// Runs WC_INSTANCES engines through a WaveEngineBatch and a copy of each on its own, in
+// process calls of random lengths, and compares the outputs. Without stereo, in1 and out1
+// are NULL.
+static bool checkBatch(bool stereo) {
+	std::vector<float> signals(2 * WC_INSTANCES * WC_SIGNAL_SIZE),
+	                   outs(4 * WC_INSTANCES * WC_MAX_CHUNK, 0.0f);
+	WaveEngine *single[WC_INSTANCES], *batched[WC_INSTANCES];
+	float *in0[WC_INSTANCES], *in1[WC_INSTANCES], *out0[WC_INSTANCES], *out1[WC_INSTANCES];
+	WaveEngineBatch batch;
+	Random random(1);
+	bool ok = true;
+	
+	makeSignal(&signals[0], (int) signals.size(), random);
+	
+	for (int k = 0; k < WC_INSTANCES; k++) {
+		single[k] = makeEngine(k, stereo, 100 + k);
+		batched[k] = makeEngine(k, stereo, 100 + k);
+		
+		if (single[k] == NULL || batched[k] == NULL) {
+			std::puts("  Engine initialization failed");
+			return false;
+		}
+	}
+	
+	if (!batch.setEngines(batched, WC_INSTANCES)) {
+		std::puts("  Batch allocation failed");
+		return false;
+	}
+	
+	for (int pos = 0; ok && pos < WC_SIGNAL_SIZE; ) {
+		int n = std::min(1 + random.below(WC_MAX_CHUNK), WC_SIGNAL_SIZE - pos);
+		
+		// Parameter changes between process calls.
+		if (random.below(50) == 0) {
+			int k = random.below(WC_INSTANCES), index = kNumMonoParams + random.below(2*kNumParams);
+			float value = random.uniform();
+			
+			single[k]->setParameter(index, value);
+			batched[k]->setParameter(index, value);
+		}
+		
+		for (int k = 0; k < WC_INSTANCES; k++) {
+			in0[k] = &signals[2*k * WC_SIGNAL_SIZE + pos];
+			in1[k] = in0[k] + WC_SIGNAL_SIZE;
+			out0[k] = &outs[4*k * WC_MAX_CHUNK];
+			out1[k] = out0[k] + WC_MAX_CHUNK;
+			
+			single[k]->processReplacing(in0[k], in1[k], out0[k], out1[k], n);
+			
+			out0[k] += 2*WC_MAX_CHUNK;
+			out1[k] += 2*WC_MAX_CHUNK;
+		}
+		
+		batch.processReplacing(in0, (stereo) ? in1 : NULL, out0, (stereo) ? out1 : NULL, n);
+		
+		for (int k = 0; ok && k < WC_INSTANCES; k++) {
+			const float *expected = &outs[4*k * WC_MAX_CHUNK];
+			
+			for (int c = 0; c < 2; c++) {
+				const float *e = expected + c*WC_MAX_CHUNK, *b = e + 2*WC_MAX_CHUNK;
+				
+				if (std::memcmp(e, b, n * sizeof (float))) {
+					int i = 0;
+					while (std::memcmp(e + i, b + i, sizeof (float)) == 0)
+						i++;
+					std::printf(
+						"  Engine %d output %d differs at frame %d: %.9g alone, %.9g batched\n",
+						k, c, pos + i, e[i], b[i]);
+					ok = false;
+					break;
+				}
+			}
+		}
+		
+		pos += n;
+	}
+	
+	for (int k = 0; k < WC_INSTANCES; k++) {
+		delete single[k];
+		delete batched[k];
+	}
+	
+	return ok;
+}
+
+static bool checkBatchStereo() {return checkBatch(true);}
+static bool checkBatchMono() {return checkBatch(false);}
+
+
+// ---<<< trackLanes >>>---
+// A value that's loud, quiet, denormal or a signed zero now and then, so every compare has
+// its edge cases.
+static float randomSample(Random &random) {
+	switch (random.below(8)) {
+		case 0:
+		return 0.0f;
+		
+		case 1:
+		return -0.0f;
+		
+		case 2:
+		return (random.uniform() - 0.5f) * 1.0e-38f;
+		
+		case 3:
+		return (random.uniform() - 0.5f) * 0.01f;
+		
+		default:
+		return 2.0f*random.uniform() - 1.0f;
+	}
+}
+
+// Random settings and a random state that an analyzer could be in.
+static void makeLanes(TrackerLanes &lanes, float (*records)[WC_LANE_RECORD_SIZE], Random &random) {
+	for (int l = 0; l < WP_TRACKER_LANES; l++) {
+		lanes.aIncW[l] = random.uniform();
+		lanes.aDecW[l] = random.uniform();
+		lanes.ampGate[l] = 0.3f * random.uniform();
+		lanes.sampleGate[l] = 0.5f * random.uniform();
+		lanes.highTrig[l] = 2.0f*random.uniform() - 1.0f;
+		lanes.lowTrig[l] = 2.0f*random.uniform() - 1.0f;
+		lanes.inverted[l] = -random.below(2);
+		lanes.minSize[l] = 2 + random.below(40);
+		lanes.maxSize[l] = lanes.minSize[l] + 1 + random.below(WC_LANE_RECORD_SIZE - 50);
+		lanes.active[l] = (random.below(6) != 0) ? -1 : 0;
+		
+		lanes.amplitude[l] = std::max(WP_TRACKER_MIN_AMPLITUDE, std::abs(randomSample(random)));
+		lanes.maxSample[l] = std::abs(randomSample(random));
+		lanes.cycleStart[l] = -random.uniform();
+		lanes.disabled[l] = (lanes.active[l] && random.below(3) != 0) ? 0 : -1;
+		lanes.detectPeak[l] = -random.below(2);
+		lanes.trigCount[l] = random.below(3);
+		lanes.size[l] = random.below(lanes.maxSize[l]);
+		lanes.record[l] = records[l];
+		
+		for (int i = 0; i < lanes.size[l]; i++)
+			records[l][i] = randomSample(random);
+		lanes.previous[l] = (lanes.size[l] > 0) ? records[l][lanes.size[l]-1] : randomSample(random);
+	}
+}
+
+// Starts the next cycle of the lanes in ended, like Analyzer::updateFreqAndWave does.
+static void startCycles(TrackerLanes &lanes, unsigned int ended) {
+	for (int l = 0; l < WP_TRACKER_LANES; l++) {
+		if (!(ended & 1u << l))
+			continue;
+		
+		float sample = lanes.record[l][lanes.size[l]-1];
+		lanes.trigCount[l] = 0;
+		lanes.detectPeak[l] = lanes.inverted[l];
+		lanes.cycleStart[l] = 0.0f;
+		lanes.maxSample[l] = std::abs(sample);
+		lanes.size[l] = 1;
+		lanes.record[l][0] = sample;
+	}
+}
+
+// Compares the state and recordings of two copies of the lanes. The recordings are only
+// compared up to the size of the copy a.
+static bool sameLanes(const TrackerLanes &a, const TrackerLanes &b) {
+#define WC_SAME(field) (std::memcmp(a.field, b.field, sizeof a.field) == 0)
+	
+	if (!(WC_SAME(amplitude) && WC_SAME(maxSample) && WC_SAME(cycleStart) && WC_SAME(previous) &&
+	      WC_SAME(disabled) && WC_SAME(detectPeak) && WC_SAME(trigCount) && WC_SAME(size)))
+		return false;
+#undef WC_SAME
+	
+	for (int l = 0; l < WP_TRACKER_LANES; l++) {
+		if (std::memcmp(a.record[l], b.record[l], a.size[l] * sizeof (float)))
+			return false;
+	}
+	
+	return true;
+}
+
+// Steps copies of random lanes through random frames with the scalar implementation and
+// every other one the CPU supports, and compares them after each call.
+static bool checkTrackLanes() {
+	static float records[2][WP_TRACKER_LANES][WC_LANE_RECORD_SIZE];
+	static float in[WC_LANE_RECORD_SIZE * WP_TRACKER_LANES];
+	TrackerLanes expected, actual;
+	Random random(2);
+	
+	for (int s = kKernelsSSE2; s < kNumKernelSets; s++) {
+		if (!isKernelSetSupported((KernelSet) s)) {
+			std::printf("  %s not supported\n", kernelSetNames[s]);
+			continue;
+		}
+		
+		for (int t = 0; t < WC_LANE_TRIALS; t++) {
+			unsigned int laneSeed = random.next();
+			Random expectedRandom(laneSeed), actualRandom(laneSeed);
+			int n = 1 + random.below(64);
+			
+			for (int i = 0; i < n * WP_TRACKER_LANES; i++)
+				in[i] = randomSample(random);
+			
+			makeLanes(expected, records[0], expectedRandom);
+			makeLanes(actual, records[1], actualRandom);
+			
+			for (int pos = 0; pos < n; ) {
+				const float *frames = in + pos*WP_TRACKER_LANES;
+				unsigned int expectedEnded, actualEnded;
+				int expectedDone = trackLanesWith(kKernelsScalar, expected, frames, n - pos, expectedEnded),
+				    actualDone = trackLanesWith((KernelSet) s, actual, frames, n - pos, actualEnded);
+				
+				if (actualDone != expectedDone || actualEnded != expectedEnded ||
+				    !sameLanes(expected, actual)) {
+					std::printf(
+						"  %s differs from scalar in trial %d at frame %d: stepped %d and %d frames,"
+						" ended lanes %02x and %02x\n",
+						kernelSetNames[s], t, pos, actualDone, expectedDone, actualEnded, expectedEnded);
+					return false;
+				}
+				
+				startCycles(expected, expectedEnded);
+				startCycles(actual, actualEnded);
+				pos += expectedDone;
+			}
+		}
+		
+		std::printf("  %s matches scalar\n", kernelSetNames[s]);
+	}
+	
+	return true;
+}
+
+
+// ---<<< Runner >>>---
+struct Check {
+	const char *name;
+	bool (*func)();
+};
+
+int main() {
+	static const Check checks[] = {
+		{"WaveEngineBatch/stereo", checkBatchStereo},
+		{"WaveEngineBatch/mono", checkBatchMono},
+		{"trackLanes", checkTrackLanes}
+	};
+	int nFailed = 0;
+	
+	std::printf("Waveform kernels: %s\n\n", getWaveKernelsName());
+	
+	for (size_t i = 0; i < sizeof checks / sizeof checks[0]; i++) {
+		std::printf("%s\n", checks[i].name);
+		std::fflush(stdout);
+		
+		bool ok = checks[i].func();
+		nFailed += !ok;
+		std::printf("  %s\n", (ok) ? "ok" : "FAILED");
+	}
+	
+	return (nFailed > 0) ? 1 : 0;
+}
@@ -0,0 +1,548 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "WaveEngine.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Macro for standard processing method.
+// The frames are processed in blocks that end where a synthesizer may call fillBuffer,
+// so the analyzers can take a whole block at once and still be up to date when the
+// synthesizers read them. ana2In is the input of analyzer 2 (in0 for single input).
+// The synthesizers keep running while bypassed. While the graph is quiescent the
+// synthesizer buffers hold zeros and only the output statements run.
+#define PROC_METHOD(ana2In, outStatements) \
+(float *in0, float *in1, float *out0, float *out1, int sampleFrames) { \
+	while (sampleFrames > 0) { \
+		bool skipped; \
+		int blockFrames = beginBlock(in0, ana2In, sampleFrames, skipped); \
+		sampleFrames -= blockFrames; \
+		if (!skipped) { \
+			ana1.processBlock(in0, blockFrames); \
+			ana2.processBlock(ana2In, blockFrames); \
+			renderBlock(blockFrames); \
+		} \
+		{outStatements} \
+		in0 += blockFrames; \
+		in1 += blockFrames; \
+		out0 += blockFrames; \
+		out1 += blockFrames; \
+	} \
+}
+
+// Macro for the output statements of a block, for the replacing handlers.
+#define OUT_METHOD(outStatements) \
+(float *in0, float *in1, float *out0, float *out1, int blockFrames) { \
+	outStatements \
+}
+
+// Block helpers for processing methods.
+#define COPY_BLOCK(from, to) for (int i = 0; i < blockFrames; i++) (to)[i] = (from)[i];
+#define ADD_BLOCK(from, to) for (int i = 0; i < blockFrames; i++) (to)[i] += (from)[i];
+#define MOD_O1_BLOCK(to) modO1.processBlock(synBuffer1, synBuffer2, (to), blockFrames);
+#define MOD_O2_BLOCK(to) modO2.processBlock(synBuffer2, synBuffer1, (to), blockFrames);
+
+// Public static data.
+const char *const WaveEngine::paramNames[kNumParams] = {
+	"AIncLag", "ADecLag", "GatLvlA", "GatLvlS", "HiTrig", "LowTrig",
+	"FMin", "FMax", "FLag", "WLag", "InvTrig", "Interp",
+	"AModTyp", "AModMix", "FModTyp", "FModMix", "WModTyp", "WModMix",
+	"AOffset", "AGain", "FOffset", "FGain", "Oversmp", "SmooWin",
+	"OModTyp", "OModMix"
+};
+
+const float WaveEngine::initParamValues[kNumParams] = {
+	0.1f, 0.8f, 0.05f, 0.75f, 0.783f, 0.217f, 0.00055f, 0.73f, 0.0f, 0.0f, 0.0f, 1.0f,
+	0.0f, 0.0f,
+	0.0f, 0.0f,
+	0.0f, 0.0f,
+	0.5f, 0.5f, 0.5f, 0.5f, 0.0f, 0.0f,
+	0.0f, 0.0f
+};
+
+// Private static data.
+const WaveEngine::methodf WaveEngine::paramSetters[kNumParams] = {
+	&WaveEngine::aAIWSetter,
+	&WaveEngine::aADWSetter,
+	&WaveEngine::aAGLSetter,
+	&WaveEngine::aSGLSetter,
+	&WaveEngine::aFHTSetter,
+	&WaveEngine::aFLTSetter,
+	&WaveEngine::aFMinSetter,
+	&WaveEngine::aFMaxSetter,
+	&WaveEngine::aFWSetter,
+	&WaveEngine::aWWSetter,
+	&WaveEngine::aITSetter,
+	&WaveEngine::aWISetter,
+	
+	&WaveEngine::mAModSetter,
+	&WaveEngine::mAMixSetter,
+	
+	&WaveEngine::mFModSetter,
+	&WaveEngine::mFMixSetter,
+	
+	&WaveEngine::mWModSetter,
+	&WaveEngine::mWMixSetter,
+	
+	&WaveEngine::sAOffSetter,
+	&WaveEngine::sAGainSetter,
+	&WaveEngine::sFOffSetter,
+	&WaveEngine::sFGainSetter,
+	&WaveEngine::sOverSetter,
+	&WaveEngine::sWindSetter,
+	
+	&WaveEngine::mOModSetter,
+	&WaveEngine::mOMixSetter
+};
+
+const WaveEngine::method4fpi WaveEngine::procHandlers[9] = {
+	&WaveEngine::proc1In1Out,
+	&WaveEngine::proc1In1OutB,
+	&WaveEngine::proc1In2Out,
+	&WaveEngine::proc1In2OutB,
+	&WaveEngine::proc2In1Out,
+	&WaveEngine::proc2In1OutB,
+	&WaveEngine::proc2In2Out,
+	&WaveEngine::proc2In2OutB,
+	
+	&WaveEngine::procDoNothing // Fallback handler for error states.
+};
+
+const WaveEngine::method4fpi WaveEngine::procRHandlers[9] = {
+	&WaveEngine::procR1In1Out,
+	&WaveEngine::procR1In1OutB,
+	&WaveEngine::procR1In2Out,
+	&WaveEngine::procR1In2OutB,
+	&WaveEngine::procR2In1Out,
+	&WaveEngine::procR2In1OutB,
+	&WaveEngine::procR2In2Out,
+	&WaveEngine::procR2In2OutB,
+	
+	&WaveEngine::procDoNothing // Fallback handler for error states.
+};
+
+const WaveEngine::method4fpi WaveEngine::outRHandlers[9] = {
+	&WaveEngine::outR1In1Out,
+	&WaveEngine::outR1In1OutB,
+	&WaveEngine::outR1In2Out,
+	&WaveEngine::outR1In2OutB,
+	&WaveEngine::outR2In1Out,
+	&WaveEngine::outR2In1OutB,
+	&WaveEngine::outR2In2Out,
+	&WaveEngine::outR2In2OutB,
+	
+	&WaveEngine::procDoNothing // Fallback handler for error states.
+};
+
+
+// Public static methods.
+float WaveEngine::getInitParamValue(int index) {
+	if (index < kNumMonoParams)
+		return (index == kBufferSize) ? 2.0f / 7.0f : 0.0f;
+	
+	return initParamValues[(index - kNumMonoParams) % kNumParams];
+}
+
+
+// Public methods.
+WaveEngine::WaveEngine() {
+	operational = false;
+	twoInputs = false;
+	bufferSizeMultiplier = 1;
+	editMode = -1;
+	skipSilence = true;
+	quiescent = false;
+	silentFrames = 0;
+	procHandler = procHandlers[8];
+	procRHandler = procRHandlers[8];
+	outRHandler = outRHandlers[8];
+}
+
+bool WaveEngine::initialize(int bufferSizeMult) {
+	// Processing components.
+	ana1.initialize(this);
+	ana2.initialize(this);
+	ana1.setIncrementalUpdates(true);
+	ana2.setIncrementalUpdates(true);
+	ana1.setFractionalCycles(true);
+	ana2.setFractionalCycles(true);
+	modA1.initialize(ana1.getAmpFunction(), ana2.getAmpFunction());
+	modA2.initialize(ana2.getAmpFunction(), ana1.getAmpFunction());
+	modF1.initialize(ana1.getFreqFunction(), ana2.getFreqFunction(), hzToUnsigned(261.63f));
+	modF2.initialize(ana2.getFreqFunction(), ana1.getFreqFunction(), hzToUnsigned(261.63f));
+	modW1.initialize(ana1.getWaveFunction(), ana2.getWaveFunction());
+	modW2.initialize(ana2.getWaveFunction(), ana1.getWaveFunction());
+	syn1.initialize(this, &modA1, &modF1, &modW1);
+	syn2.initialize(this, &modA2, &modF2, &modW2);
+	modO1.initialize(syn1.getAudioFunction(), syn2.getAudioFunction());
+	modO2.initialize(syn2.getAudioFunction(), syn1.getAudioFunction());
+	
+	editMode = -1; // NOT 0 or 1.
+	
+	// Attempt to allocate minimal sample buffers.
+	operational = true;
+	if (!setBufferSizeMultiplier(bufferSizeMult))
+		operational = false;
+	
+	// Set initial processing handlers.
+	setProcessMode(false, false, false);
+	
+	return operational;
+}
+
+void WaveEngine::reset() {
+	wake();
+	ana1.reset();
+	ana2.reset();
+	syn1.reset();
+	syn2.reset();
+}
+
+bool WaveEngine::setBufferSizeMultiplier(int multiplier) {
+	int anaSize = (int) (multiplier * (WP_ANA_BUFFER_SIZE * globalSampleRate) / WP_STD_SAMPLE_RATE),
+			synSize = (int) (multiplier * (WP_SYN_BUFFER_SIZE * globalSampleRate) / WP_STD_SAMPLE_RATE),
+			oldAnaSize = ana1.getBufferSize(),
+			oldSynSize = syn1.getBufferSize();
+	
+	wake();
+	
+	if (!(ana1.setBufferSize(anaSize) && ana2.setBufferSize(anaSize) &&
+				syn1.setBufferSize(synSize) && syn2.setBufferSize(synSize))) {
+		
+		if (!(ana1.setBufferSize(oldAnaSize) && ana2.setBufferSize(oldAnaSize) &&
+					syn1.setBufferSize(oldSynSize) && syn2.setBufferSize(oldSynSize))) {
+			operational = false;
+			procHandler = procHandlers[8]; // Use do-nothing handlers.
+			procRHandler = procRHandlers[8];
+		}
+		
+		return false;
+	}
+	
+	bufferSizeMultiplier = multiplier;
+	return true;
+}
+
+bool WaveEngine::setSampleRate(float sampleRate) {
+	float oldSampleRate = globalSampleRate;
+	
+	setGlobalSampleRate(sampleRate);
+	
+	if (setBufferSizeMultiplier(bufferSizeMultiplier))
+		return true;
+	
+	if (operational) // Old buffer size restored.
+		setGlobalSampleRate(oldSampleRate);
+	return false;
+}
+
+void WaveEngine::setRampTime(float seconds) {
+	modA1.setRampTime(seconds);
+	modA2.setRampTime(seconds);
+	modF1.setRampTime(seconds);
+	modF2.setRampTime(seconds);
+	modW1.setRampTime(seconds);
+	modW2.setRampTime(seconds);
+	syn1.setRampTime(seconds);
+	syn2.setRampTime(seconds);
+	modO1.setRampTime(seconds);
+	modO2.setRampTime(seconds);
+}
+
+bool WaveEngine::setBandLimited(bool onOff) {
+	if (syn1.setBandLimited(onOff) && syn2.setBandLimited(onOff))
+		return true;
+	
+	syn1.setBandLimited(false);
+	syn2.setBandLimited(false);
+	return false;
+}
+
+bool WaveEngine::setParameter(int index, float value) {
+	wake();
+	
+	if (index < kNumMonoParams) {
+		// Ignore attempts to set the "PlugVersion" dummy parameter.
+		return index == kBufferSize && setBufferSizeMultiplier(BUFFER_SIZE_T(value));
+	}
+	
+	long stereoIndex = index - kNumMonoParams;
+	
+	setEditMode((stereoIndex < kNumParams) ? 0 : 1);
+	
+	(this->*paramSetters[stereoIndex % kNumParams])(value);
+	return true;
+}
+
+float WaveEngine::getAmplitude(int channel, bool postmod) {
+	return (channel == 0)
+		? ((postmod) ? syn1.getAmplitude() : ana1.getAmplitude())
+		: ((channel == 1)
+			? ((postmod) ? syn2.getAmplitude() : ana2.getAmplitude())
+	    : 0.0f);
+}
+
+float WaveEngine::getFrequency(int channel, bool postmod) {
+	return (channel == 0)
+		? ((postmod) ? syn1.getFrequency() : ana1.getFrequency())
+		: ((channel == 1)
+			? ((postmod) ? syn2.getFrequency() : ana2.getFrequency())
+	    : 0.0f);
+}
+
+// Input levels are compared with WP_ANA_MIN_AMPLITUDE, since louder samples would raise the
+// amplitude outputs.
+static bool isSilentBlock(const float *in, int n) {
+	for (int i = 0; i < n; i++) {
+		if (std::abs(in[i]) > WP_ANA_MIN_AMPLITUDE)
+			return false;
+	}
+	return true;
+}
+
+static float peakLevel(const float *block, int n) {
+	float peak = 0.0f;
+	for (int i = 0; i < n; i++)
+		peak = std::max(peak, std::abs(block[i]));
+	return peak;
+}
+
+int WaveEngine::beginBlock(const float *ana1In, const float *ana2In, int maxFrames, bool &skipped) {
+	int blockFrames =
+		std::min(std::min(maxFrames, (int) WP_PROC_BLOCK_SIZE),
+		         std::min(syn1.getTicksBeforeFill(), syn2.getTicksBeforeFill()));
+	
+	skipped = quiescent && skipQuiescentBlock(ana1In, ana2In, blockFrames);
+	return blockFrames;
+}
+
+void WaveEngine::renderBlock(int blockFrames) {
+	syn1.render(synBuffer1, blockFrames);
+	syn2.render(synBuffer2, blockFrames);
+	if (skipSilence)
+		trackSilence(blockFrames);
+}
+
+bool WaveEngine::skipQuiescentBlock(const float *in0, const float *in1, int blockFrames) {
+	if (ana1.isIdle() && ana2.isIdle() &&
+	    isSilentBlock(in0, blockFrames) && isSilentBlock(in1, blockFrames))
+		return true;
+	
+	wake();
+	return false;
+}
+
+void WaveEngine::trackSilence(int blockFrames) {
+	if (!(ana1.isIdle() && ana2.isIdle() &&
+	      peakLevel(synBuffer1, blockFrames) < WP_SILENCE_LEVEL &&
+	      peakLevel(synBuffer2, blockFrames) < WP_SILENCE_LEVEL)) {
+		silentFrames = 0;
+		return;
+	}
+	
+	int bufferFrames = std::max(syn1.getBufferSize(), syn2.getBufferSize());
+	if (silentFrames <= bufferFrames)
+		silentFrames += blockFrames;
+	
+	// The amplitudes must be low too, or the next cycles could be loud.
+	if (silentFrames > bufferFrames &&
+	    syn1.getAmplitude() < WP_SILENCE_LEVEL && syn2.getAmplitude() < WP_SILENCE_LEVEL) {
+		quiescent = true;
+		std::fill(synBuffer1, synBuffer1 + WP_PROC_BLOCK_SIZE, 0.0f);
+		std::fill(synBuffer2, synBuffer2 + WP_PROC_BLOCK_SIZE, 0.0f);
+	}
+}
+
+void WaveEngine::setProcessMode(bool twoInputs, bool twoOutputs, bool bypassed) {
+	if (!operational) { // Unrecoverable error.
+		procHandler = procHandlers[8]; // Use do-nothing handlers.
+		procRHandler = procRHandlers[8];
+		outRHandler = outRHandlers[8];
+		return;
+	}
+	
+	int handlerIndex = twoInputs << 2 | twoOutputs << 1 | bypassed;
+	
+	this->twoInputs = twoInputs;
+	procHandler = procHandlers[handlerIndex];
+	procRHandler = procRHandlers[handlerIndex];
+	outRHandler = outRHandlers[handlerIndex];
+}
+
+
+// Setters.
+void WaveEngine::setEditMode(int mode) {
+	if (mode == 0 && editMode != 0) {
+		editMode = 0;
+		
+		anaE  = &ana1;
+		modAE = &modA1;
+		modFE = &modF1;
+		modWE = &modW1;
+		synE  = &syn1;
+		modOE = &modO1;
+	}
+	else if (mode == 1 && editMode != 1) {
+		editMode = 1;
+		
+		anaE  = &ana2;
+		modAE = &modA2;
+		modFE = &modF2;
+		modWE = &modW2;
+		synE  = &syn2;
+		modOE = &modO2;
+	}
+}
+
+void WaveEngine::aAIWSetter(float value) {anaE->setAIncWeight(INC_LAG_T(value));}
+
+void WaveEngine::aADWSetter(float value) {anaE->setADecWeight(DEC_LAG_T(value));}
+
+void WaveEngine::aAGLSetter(float value) {anaE->setAmpGateLevel(A_GATE_LVL_T(value));}
+
+void WaveEngine::aSGLSetter(float value) {anaE->setSampleGateLevel(S_GATE_LVL_T(value));}
+
+void WaveEngine::aFHTSetter(float value) {anaE->setHighTrig(TRIG_LVL_T(value));}
+
+void WaveEngine::aFLTSetter(float value) {anaE->setLowTrig(TRIG_LVL_T(value));}
+
+void WaveEngine::aFMinSetter(float value) {anaE->setFMin(F_MIN_T(value));}
+
+void WaveEngine::aFMaxSetter(float value) {anaE->setFMax(F_MAX_T(value));}
+
+void WaveEngine::aFWSetter(float value) {anaE->setFWeight(F_LAG_T(value));}
+
+void WaveEngine::aWWSetter(float value) {anaE->setWWeight(W_LAG_T(value));}
+
+void WaveEngine::aITSetter(float value) {anaE->setTrigInverted(BOOL_T(value));}
+
+void WaveEngine::aWISetter(float value) {anaE->setWInterpolation(BOOL_T(value));}
+
+void WaveEngine::mAModSetter(float value) {modAE->setModulation(U_MOD_TYPE_T(value));}
+
+void WaveEngine::mAMixSetter(float value) {modAE->setMix(value);}
+
+void WaveEngine::mFModSetter(float value) {modFE->setModulation(U_MOD_TYPE_T(value));}
+
+void WaveEngine::mFMixSetter(float value) {modFE->setMix(value);}
+
+void WaveEngine::mWModSetter(float value) {modWE->setModulation(F_MOD_TYPE_T(value));}
+
+void WaveEngine::mWMixSetter(float value) {modWE->setMix(value);}
+
+void WaveEngine::sAOffSetter(float value) {synE->setAOffset(A_OFFSET_T(value));}
+
+void WaveEngine::sAGainSetter(float value) {synE->setAGain(A_GAIN_T(value));}
+
+void WaveEngine::sFOffSetter(float value) {synE->setFOffset(F_OFFSET_T(value));}
+
+void WaveEngine::sFGainSetter(float value) {synE->setFGain(F_GAIN_T(value));}
+
+void WaveEngine::sOverSetter(float value) {synE->setOversamplingMultiplier(OVER_T(value));}
+
+void WaveEngine::sWindSetter(float value) {synE->setSmoothingWindow(WINDOW_T(value));}
+
+void WaveEngine::mOModSetter(float value) {modOE->setModulation(S_MOD_TYPE_T(value));}
+
+void WaveEngine::mOMixSetter(float value) {modOE->setMix(value);}
+
+
+// Processing handlers.
+void WaveEngine::proc1In1Out PROC_METHOD(in0,
+	MOD_O1_BLOCK(modBuffer) ADD_BLOCK(modBuffer, out0))
+
+void WaveEngine::proc1In1OutB PROC_METHOD(in0,
+	ADD_BLOCK(in0, out0))
+
+void WaveEngine::proc1In2Out PROC_METHOD(in0,
+	MOD_O1_BLOCK(modBuffer) ADD_BLOCK(modBuffer, out0)
+	MOD_O2_BLOCK(modBuffer) ADD_BLOCK(modBuffer, out1))
+
+void WaveEngine::proc1In2OutB PROC_METHOD(in0,
+	ADD_BLOCK(in0, out0)
+	ADD_BLOCK(in0, out1))
+
+void WaveEngine::proc2In1Out PROC_METHOD(in1,
+	MOD_O1_BLOCK(modBuffer) ADD_BLOCK(modBuffer, out0))
+
+void WaveEngine::proc2In1OutB PROC_METHOD(in1,
+	ADD_BLOCK(in0, out0))
+
+void WaveEngine::proc2In2Out PROC_METHOD(in1,
+	MOD_O1_BLOCK(modBuffer) ADD_BLOCK(modBuffer, out0)
+	MOD_O2_BLOCK(modBuffer) ADD_BLOCK(modBuffer, out1))
+
+void WaveEngine::proc2In2OutB PROC_METHOD(in1,
+	ADD_BLOCK(in0, out0)
+	ADD_BLOCK(in1, out1))
+
+void WaveEngine::procR1In1Out PROC_METHOD(in0,
+	outR1In1Out(in0, in1, out0, out1, blockFrames);)
+
+void WaveEngine::procR1In1OutB PROC_METHOD(in0,
+	outR1In1OutB(in0, in1, out0, out1, blockFrames);)
+
+void WaveEngine::procR1In2Out PROC_METHOD(in0,
+	outR1In2Out(in0, in1, out0, out1, blockFrames);)
+
+void WaveEngine::procR1In2OutB PROC_METHOD(in0,
+	outR1In2OutB(in0, in1, out0, out1, blockFrames);)
+
+void WaveEngine::procR2In1Out PROC_METHOD(in1,
+	outR2In1Out(in0, in1, out0, out1, blockFrames);)
+
+void WaveEngine::procR2In1OutB PROC_METHOD(in1,
+	outR2In1OutB(in0, in1, out0, out1, blockFrames);)
+
+void WaveEngine::procR2In2Out PROC_METHOD(in1,
+	outR2In2Out(in0, in1, out0, out1, blockFrames);)
+
+void WaveEngine::procR2In2OutB PROC_METHOD(in1,
+	outR2In2OutB(in0, in1, out0, out1, blockFrames);)
+
+// Output statements of the replacing handlers.
+void WaveEngine::outR1In1Out OUT_METHOD(
+	MOD_O1_BLOCK(out0))
+
+void WaveEngine::outR1In1OutB OUT_METHOD(
+	COPY_BLOCK(in0, out0))
+
+void WaveEngine::outR1In2Out OUT_METHOD(
+	MOD_O1_BLOCK(out0)
+	MOD_O2_BLOCK(out1))
+
+void WaveEngine::outR1In2OutB OUT_METHOD(
+	COPY_BLOCK(in0, out0)
+	COPY_BLOCK(in0, out1))
+
+void WaveEngine::outR2In1Out OUT_METHOD(
+	MOD_O1_BLOCK(out0))
+
+void WaveEngine::outR2In1OutB OUT_METHOD(
+	COPY_BLOCK(in0, out0))
+
+void WaveEngine::outR2In2Out OUT_METHOD(
+	MOD_O1_BLOCK(out0)
+	MOD_O2_BLOCK(out1))
+
+void WaveEngine::outR2In2OutB OUT_METHOD(
+	COPY_BLOCK(in0, out0)
+	COPY_BLOCK(in1, out1))
@@ -0,0 +1,312 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_WAVEENGINE_HPP
+#define WP_WAVEENGINE_HPP
+
+#include "wpstdinclude.h"
+
+#include "BufferManager.hpp"
+#include "Analyzer.hpp"
+#include "wpmodulators.hpp"
+#include "Synthesizer.hpp"
+#include "waveplugparams.h"
+
+#define WP_ANA_BUFFER_SIZE 1250
+#define WP_SYN_BUFFER_SIZE 1250
+
+#define WP_PROC_BLOCK_SIZE 256
+
+// Synthesizer output level below which a block counts as silent (-120 dB).
+#define WP_SILENCE_LEVEL 1.0e-6f
+
+// Time in seconds over which mix, gain and offset parameter changes are ramped.
+#define WP_PARAM_RAMP_TIME 0.02f
+
+// Parameter transform macros.
+#define BUFFER_SIZE_T(v) (1 << (int) (7.0f*(v) + 0.5f))
+
+#define INC_LAG_T(v) (std::pow(std::log10(9.0f*(v) + 1.0f), 0.2f))
+#define DEC_LAG_T(v) (std::pow(std::log10(9.0f*(v) + 1.0f), 0.01f))
+#define A_GATE_LVL_T(v) ((std::pow(2.0f, 12.0f*(v)) - 1.0f)/4095.0f)
+#define S_GATE_LVL_T(v) A_GATE_LVL_T(v)
+#define TRIG_LVL_T(v) (3.0f*((v)-0.5f))
+#define F_MIN_T(v) ((globalMaxFrequency - 1.0f)*(std::pow(2.0f, 9.0f*(v)) - 1.0f)/511.0f + 1.0f)
+#define F_MAX_T(v) F_MIN_T(v)
+#define F_LAG_T(v) (std::pow(std::log10(9.0f*(v) + 1.0f), 0.4f))
+#define W_LAG_T(v) F_LAG_T(v)
+#define BOOL_T(v) ((v) > 0.5f)
+#define U_MOD_TYPE_T(v) ((ModulationTypeU) (unsigned int) (0.999f*((v)*kNModTypesU)))
+#define F_MOD_TYPE_T(v) ((ModulationTypeF) (unsigned int) (0.999f*((v)*kNModTypesF)))
+#define A_OFFSET_T(v) (2.0f*((v)-0.5f))
+#define A_GAIN_T(v) (((v) > 0.5f) \
+                     ? ((((v) > 0.9999f)) ? 5000.0f : 1.0f / (2.0f*(1.0f - (v)))) \
+                     : 2.0f*(v))
+#define F_OFFSET_T(v) (((v) > 0.5f) \
+                       ? (std::pow(2.0f, 32.0f*((v)-0.5f)) - 1.0f)/65535.0f \
+                       : -(std::pow(2.0f, 32.0f*(0.5f-(v))) - 1.0f)/65535.0f)
+#define F_GAIN_T(v) (((v) > 0.5f) \
+                     ? ((((v) > 0.9999f)) ? 5000.0f : 1.0f / (2.0f*(1.0f - (v)))) \
+                     : 2.0f*(v))
+#define OVER_T(v) (1 + (int) (15.0f*(v)))
+#define WINDOW_T(v) ((int) (250.0f*(v)))
+#define S_MOD_TYPE_T(v) ((ModulationTypeS) (unsigned int) (0.999f*((v)*kNModTypesS)))
+
+// The processing graph of the plugin without the plugin around it.
+// Analyzer 1 listens to input 0 and analyzer 2 to input 1. Channel 1 and 2 each have
+// amplitude, frequency and waveform modulators feeding a synthesizer, and an output modulator
+// mixing the two synthesizers. Parameters use the plugin's indexes and 0-1 values.
+// NOTE: Not thread safe. The plugin keeps all calls on its processing thread.
+class WaveEngine : public BufferManager {
+private: // private typedefs
+	typedef void (WaveEngine::*methodf)(float);
+	typedef void (WaveEngine::*method4fpi)(float *, float *, float *, float *, int);
+	
+public: // public static data members
+	static const char *const paramNames[kNumParams];
+	static const float initParamValues[kNumParams];
+	
+private: // private static data members
+	static const methodf paramSetters[kNumParams];
+	
+	// Processing handlers.
+	static const method4fpi procHandlers[9], procRHandlers[9];
+	
+	// Output statements of the replacing handlers for one processing block.
+	static const method4fpi outRHandlers[9];
+	
+private: // private data members
+	// Processing components.
+	Analyzer ana1, ana2, *anaE;
+	UnsignedModulator modA1, modA2, *modAE, modF1, modF2, *modFE;
+	FunctionModulator modW1, modW2, *modWE;
+	Synthesizer syn1, syn2, *synE;
+	SignedModulator modO1, modO2, *modOE;
+	
+	// Synthesizer and output modulator output for the current processing block.
+	float synBuffer1[WP_PROC_BLOCK_SIZE], synBuffer2[WP_PROC_BLOCK_SIZE],
+	      modBuffer[WP_PROC_BLOCK_SIZE];
+	
+	// Setter and processing handler state.
+	bool operational, twoInputs;
+	int bufferSizeMultiplier, editMode;
+	method4fpi procHandler, procRHandler, outRHandler;
+	
+	// Silence skipping state. silentFrames counts the frames since the analyzers went idle
+	// with the synthesizer output below WP_SILENCE_LEVEL. quiescent is set once that's
+	// longer than the synthesizer buffers, when nothing loud can be left in them.
+	bool skipSilence, quiescent;
+	int silentFrames;
+	
+public: // public static methods
+	// Initial value of parameter index (all-parameter index, like setParameter).
+	static float getInitParamValue(int index);
+	
+public: // public methods
+	WaveEngine();
+	
+	// Connects and initializes all components and allocates sample buffers.
+	// Parameters keep their initial component values until set, and are not ramped
+	// until setRampTime is called. Returns false if the buffers couldn't be allocated.
+	bool initialize(int bufferSizeMult = 1);
+	void reset();
+	
+	// False after an unrecoverable allocation failure. Processing then outputs nothing.
+	bool isOperational() {return operational;}
+	
+	int getBufferSizeMultiplier() {return bufferSizeMultiplier;}
+	bool setBufferSizeMultiplier(int multiplier);
+	
+	// Changes the global sample rate and reallocates the sample buffers to match.
+	// The old rate is restored if that fails.
+	bool setSampleRate(float sampleRate);
+	
+	// Time over which later mix, gain and offset changes are ramped.
+	void setRampTime(float seconds);
+	
+	// Band-limited wavetable synthesis instead of oversampling, for both synthesizers.
+	// Not a plugin parameter. Returns false if the tables couldn't be allocated.
+	bool getBandLimited() {return syn1.getBandLimited();}
+	bool setBandLimited(bool onOff);
+	
+	// How both synthesizers reduce oversampled waveform points to samples.
+	// Not a plugin parameter; the plugin always uses kDecimBox.
+	DecimationFilter getDecimationFilter() {return syn1.getDecimationFilter();}
+	void setDecimationFilter(DecimationFilter filter) {
+		syn1.setDecimationFilter(filter);
+		syn2.setDecimationFilter(filter);
+	}
+	
+	// Waveform interpolation used by analyzer channel (0 or 1) when its Interp parameter is on.
+	// Not a plugin parameter, which only turns interpolation on (linear) and off.
+	InterpolationMode getInterpolationMode(int channel) {
+		return ((channel == 0) ? ana1 : ana2).getWInterpolationMode();
+	}
+	void setInterpolationMode(int channel, InterpolationMode mode) {
+		((channel == 0) ? ana1 : ana2).setWInterpolationMode(mode);
+	}
+	
+	// Fractional cycle lengths for both analyzers (on by default, see
+	// Analyzer::setFractionalCycles). Not a plugin parameter.
+	bool getFractionalCycles() {return ana1.getFractionalCycles();}
+	void setFractionalCycles(bool onOff) {
+		ana1.setFractionalCycles(onOff);
+		ana2.setFractionalCycles(onOff);
+	}
+	
+	// When on (the default), blocks are skipped while the graph is quiescent: both analyzers
+	// are idle (see Analyzer::isIdle), the synthesizers have been silent for longer than their
+	// buffers, and the input stays below the analyzers' amplitude floor. Skipped blocks output
+	// the output modulators' response to silence, which is silence. The first block with any
+	// input above the floor, and any parameter change, wakes the graph up.
+	// Not a plugin parameter.
+	bool getSkipSilence() {return skipSilence;}
+	void setSkipSilence(bool onOff) {skipSilence = onOff; wake();}
+	bool isQuiescent() {return quiescent;}
+	
+	// Cycle trigger used by analyzer channel (0 or 1). Not a plugin parameter; the plugin
+	// always uses kTriggerCrossing. Returns false if the period detector couldn't be allocated.
+	TriggerMode getTriggerMode(int channel) {
+		return ((channel == 0) ? ana1 : ana2).getTriggerMode();
+	}
+	bool setTriggerMode(int channel, TriggerMode mode) {
+		return ((channel == 0) ? ana1 : ana2).setTriggerMode(mode);
+	}
+	
+	// Sets parameter index (kBufferSize or a stereo parameter offset by kNumMonoParams).
+	// Returns false if the parameter wasn't changed.
+	bool setParameter(int index, float value);
+	
+	// Signal monitors. channel is 0 or 1.
+	float getAmplitude(int channel, bool postmod = false);
+	float getFrequency(int channel, bool postmod = false);
+	
+	// Selects the processing handlers. With one input, in1 is ignored and analyzer 2
+	// listens to in0. With one output, out1 is ignored.
+	void setProcessMode(bool twoInputs, bool twoOutputs, bool bypassed);
+	
+	// Accumulating and replacing processing.
+	void process(float *in0, float *in1, float *out0, float *out1, int sampleFrames) {
+		(this->*procHandler)(in0, in1, out0, out1, sampleFrames);
+	}
+	
+	void processReplacing(float *in0, float *in1, float *out0, float *out1, int sampleFrames) {
+		(this->*procRHandler)(in0, in1, out0, out1, sampleFrames);
+	}
+	
+	// The steps of processReplacing, for processing several engines with their analyzers
+	// stepped side by side (see WaveEngineBatch). beginBlock starts a processing block of up
+	// to maxFrames frames at the analyzer inputs and returns its length. skipped is set if the
+	// graph stays quiescent over it; otherwise the analyzers are given the block and
+	// renderBlock renders it. outputBlockReplacing then writes the block's output as
+	// processReplacing does. Only operational engines may be stepped.
+	int beginBlock(const float *ana1In, const float *ana2In, int maxFrames, bool &skipped);
+	void renderBlock(int blockFrames);
+	void outputBlockReplacing(float *in0, float *in1, float *out0, float *out1, int blockFrames) {
+		(this->*outRHandler)(in0, in1, out0, out1, blockFrames);
+	}
+	
+	Analyzer &getAnalyzer(int channel) {return (channel == 0) ? ana1 : ana2;}
+	
+	// Input of analyzer channel (0 or 1) given in0 and in1, as selected by setProcessMode.
+	const float *getAnalyzerInput(int channel, const float *in0, const float *in1) {
+		return (channel == 1 && twoInputs) ? in1 : in0;
+	}
+	
+private: // private methods
+	// Processes nothing and returns true if the graph is quiescent and stays so for the
+	// blockFrames frames at in0 and in1 (analyzer 1 and 2 input). Otherwise wakes it up.
+	bool skipQuiescentBlock(const float *in0, const float *in1, int blockFrames);
+	
+	// Updates the silence skipping state after a processed block.
+	void trackSilence(int blockFrames);
+	
+	void wake() {
+		quiescent = false;
+		silentFrames = 0;
+	}
+	
+	// Setters.
+	void setEditMode(int mode);
+	
+	void aAIWSetter(float value);
+	void aADWSetter(float value);
+	void aAGLSetter(float value);
+	void aSGLSetter(float value);
+	void aFHTSetter(float value);
+	void aFLTSetter(float value);
+	void aFMinSetter(float value);
+	void aFMaxSetter(float value);
+	void aFWSetter(float value);
+	void aWWSetter(float value);
+	void aITSetter(float value);
+	void aWISetter(float value);
+	
+	void mAModSetter(float value);
+	void mAMixSetter(float value);
+	
+	void mFModSetter(float value);
+	void mFMixSetter(float value);
+	
+	void mWModSetter(float value);
+	void mWMixSetter(float value);
+	
+	void sAOffSetter(float value);
+	void sAGainSetter(float value);
+	void sFOffSetter(float value);
+	void sFGainSetter(float value);
+	void sOverSetter(float value);
+	void sWindSetter(float value);
+	
+	void mOModSetter(float value);
+	void mOMixSetter(float value);
+	
+	// Processing handlers.
+	void procDoNothing(float *in0, float *in1, float *out0, float *out1, int sampleFrames) {}
+	
+	void proc1In1Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void proc1In1OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void proc1In2Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void proc1In2OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void proc2In1Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void proc2In1OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void proc2In2Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void proc2In2OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	
+	void procR1In1Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void procR1In1OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void procR1In2Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void procR1In2OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void procR2In1Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void procR2In1OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void procR2In2Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	void procR2In2OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
+	
+	void outR1In1Out(float *in0, float *in1, float *out0, float *out1, int blockFrames);
+	void outR1In1OutB(float *in0, float *in1, float *out0, float *out1, int blockFrames);
+	void outR1In2Out(float *in0, float *in1, float *out0, float *out1, int blockFrames);
+	void outR1In2OutB(float *in0, float *in1, float *out0, float *out1, int blockFrames);
+	void outR2In1Out(float *in0, float *in1, float *out0, float *out1, int blockFrames);
+	void outR2In1OutB(float *in0, float *in1, float *out0, float *out1, int blockFrames);
+	void outR2In2Out(float *in0, float *in1, float *out0, float *out1, int blockFrames);
+	void outR2In2OutB(float *in0, float *in1, float *out0, float *out1, int blockFrames);
+};
+
+#endif
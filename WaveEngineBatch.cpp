@@ -0,0 +1,232 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "WaveEngineBatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+WaveEngineBatch::WaveEngineBatch() {
+	groups = NULL;
+	nEngines = nGroups = 0;
+	interleavedStart = interleavedEnd = 0;
+}
+
+WaveEngineBatch::~WaveEngineBatch() {
+	delete[] groups;
+}
+
+bool WaveEngineBatch::setEngines(WaveEngine *const *engines, int n) {
+	delete[] groups;
+	groups = NULL;
+	nEngines = nGroups = 0;
+	
+	if (n <= 0)
+		return true;
+	
+	try {
+		groups = new Group[(n + WP_BATCH_GROUP_SIZE - 1) / WP_BATCH_GROUP_SIZE];
+	}
+	catch (const std::bad_alloc &) {
+		return false;
+	}
+	
+	nEngines = n;
+	nGroups = (n + WP_BATCH_GROUP_SIZE - 1) / WP_BATCH_GROUP_SIZE;
+	
+	for (int g = 0; g < nGroups; g++) {
+		groups[g].nEngines = std::min(n - g*WP_BATCH_GROUP_SIZE, (int) WP_BATCH_GROUP_SIZE);
+		for (int j = 0; j < groups[g].nEngines; j++)
+			groups[g].engines[j] = engines[g*WP_BATCH_GROUP_SIZE + j];
+	}
+	
+	return true;
+}
+
+void WaveEngineBatch::processReplacing(
+	float *const *in0, float *const *in1, float *const *out0, float *const *out1,
+	int sampleFrames)
+{
+	// The groups go through the whole call one after the other, so each group's state stays
+	// in the cache.
+	for (int g = 0; g < nGroups; g++) {
+		int first = g*WP_BATCH_GROUP_SIZE;
+		
+		processGroup(
+			groups[g], in0 + first, (in1 != NULL) ? in1 + first : NULL,
+			out0 + first, (out1 != NULL) ? out1 + first : NULL, sampleFrames);
+	}
+}
+
+// Buffer k of buffers at frame pos, or NULL if there are none.
+static float *framesAt(float *const *buffers, int k, int pos) {
+	return (buffers != NULL) ? buffers[k] + pos : NULL;
+}
+
+// Follows PROC_METHOD (see WaveEngine.cpp) through the engines' block steps. The synthesizers
+// only read the analyzers on the last frame of a block, so each engine's block is processed
+// when its analyzers are there, and the crossing trigger analyzers of all engines are stepped
+// together up to the nearest block end.
+void WaveEngineBatch::processGroup(
+	Group &group, float *const *in0, float *const *in1, float *const *out0, float *const *out1,
+	int sampleFrames)
+{
+	TrackerLanes &lanes = group.lanes;
+	Analyzer *analyzers[WP_TRACKER_LANES];
+	const float *anaInputs[WP_TRACKER_LANES], *laneInputs[WP_TRACKER_LANES];
+	int blockStart[WP_BATCH_GROUP_SIZE], blockEnd[WP_BATCH_GROUP_SIZE];
+	bool skipped[WP_BATCH_GROUP_SIZE];
+	unsigned int crossingLanes = 0;
+	
+	for (int j = 0; j < WP_BATCH_GROUP_SIZE; j++) {
+		WaveEngine *engine = (j < group.nEngines && group.engines[j]->isOperational())
+		                     ? group.engines[j] : NULL;
+		
+		for (int c = 0; c < 2; c++) {
+			analyzers[2*j + c] = (engine != NULL) ? &engine->getAnalyzer(c) : NULL;
+			anaInputs[2*j + c] = (engine != NULL)
+			                     ? engine->getAnalyzerInput(c, in0[j], framesAt(in1, j, 0)) : NULL;
+		}
+		
+		// Engines without blocks are never processed.
+		blockStart[j] = blockEnd[j] = (engine != NULL) ? 0 : sampleFrames;
+		skipped[j] = false;
+	}
+	
+	for (int l = 0; l < WP_TRACKER_LANES; l++) {
+		if (analyzers[l] != NULL && analyzers[l]->getTriggerMode() == kTriggerCrossing) {
+			analyzers[l]->loadTrackerLane(lanes, l);
+			laneInputs[l] = anaInputs[l];
+			crossingLanes |= 1u << l;
+		}
+		else {
+			clearLane(lanes, l);
+			laneInputs[l] = NULL; // Not interleaved.
+		}
+	}
+	
+	interleavedStart = interleavedEnd = 0;
+	int pos = 0;
+	
+	while (pos < sampleFrames) {
+		int stepEnd = sampleFrames;
+		unsigned int activeLanes = 0;
+		
+		// Start new blocks for the engines that are done with theirs.
+		for (int j = 0; j < WP_BATCH_GROUP_SIZE; j++) {
+			if (blockEnd[j] == pos) {
+				int blockFrames = group.engines[j]->beginBlock(
+					anaInputs[2*j] + pos, anaInputs[2*j + 1] + pos, sampleFrames - pos, skipped[j]);
+				
+				blockStart[j] = pos;
+				blockEnd[j] = pos + blockFrames;
+				
+				for (int l = 2*j; l < 2*j + 2; l++) {
+					if (!(crossingLanes & 1u << l))
+						continue;
+					
+					lanes.active[l] = (skipped[j]) ? 0 : -1;
+					if (!skipped[j])
+						analyzers[l]->beginBlock(blockFrames);
+				}
+			}
+			
+			stepEnd = std::min(stepEnd, blockEnd[j]);
+		}
+		
+		for (int l = 0; l < WP_TRACKER_LANES; l++)
+			activeLanes |= (lanes.active[l] & 1u) << l;
+		
+		if (activeLanes != 0)
+			trackStep(lanes, analyzers, laneInputs, pos, stepEnd - pos, sampleFrames);
+		
+		// Process the blocks that end here.
+		for (int j = 0; j < group.nEngines; j++) {
+			if (blockEnd[j] != stepEnd || analyzers[2*j] == NULL)
+				continue;
+			
+			WaveEngine &engine = *group.engines[j];
+			int start = blockStart[j], blockFrames = blockEnd[j] - start;
+			
+			if (!skipped[j]) {
+				for (int l = 2*j; l < 2*j + 2; l++) {
+					if (crossingLanes & 1u << l)
+						analyzers[l]->storeTrackerState(lanes, l);
+					else
+						analyzers[l]->processBlock(anaInputs[l] + start, blockFrames);
+				}
+				
+				engine.renderBlock(blockFrames);
+			}
+			
+			engine.outputBlockReplacing(
+				in0[j] + start, framesAt(in1, j, start), out0[j] + start, framesAt(out1, j, start),
+				blockFrames);
+		}
+		
+		pos = stepEnd;
+	}
+}
+
+void WaveEngineBatch::trackStep(
+	TrackerLanes &lanes, Analyzer *const *analyzers, const float *const *inputs, int pos, int n,
+	int sampleFrames)
+{
+	while (n > 0) {
+		// Interleave the next frames of all lanes. Steps without active lanes aren't tracked,
+		// so pos can be past the end.
+		if (pos >= interleavedEnd) {
+			interleavedStart = pos;
+			interleavedEnd = std::min(pos + (int) WP_PROC_BLOCK_SIZE, sampleFrames);
+			
+			for (int l = 0; l < WP_TRACKER_LANES; l++) {
+				float *frame = interleaved + l;
+				const float *in = (inputs[l] != NULL) ? inputs[l] + pos : NULL;
+				
+				for (int i = 0; i < interleavedEnd - pos; i++, frame += WP_TRACKER_LANES)
+					*frame = (in != NULL) ? in[i] : 0.0f;
+			}
+		}
+		
+		unsigned int ended;
+		int done = trackLanes(
+			lanes, interleaved + (pos - interleavedStart)*WP_TRACKER_LANES,
+			std::min(n, interleavedEnd - pos), ended);
+		pos += done;
+		n -= done;
+		
+		for (int l = 0; ended != 0; l++, ended >>= 1) {
+			if (ended & 1)
+				analyzers[l]->endTrackerCycle(lanes, l);
+		}
+	}
+}
+
+// An inactive, gated lane that nothing can open.
+void WaveEngineBatch::clearLane(TrackerLanes &lanes, int l) {
+	lanes.aIncW[l] = lanes.aDecW[l] = lanes.ampGate[l] = lanes.sampleGate[l] = 0.0f;
+	lanes.highTrig[l] = lanes.lowTrig[l] = 0.0f;
+	lanes.inverted[l] = lanes.minSize[l] = lanes.maxSize[l] = lanes.active[l] = 0;
+	lanes.amplitude[l] = lanes.maxSample[l] = lanes.cycleStart[l] = lanes.previous[l] = 0.0f;
+	lanes.disabled[l] = -1;
+	lanes.detectPeak[l] = lanes.trigCount[l] = lanes.size[l] = 0;
+	lanes.record[l] = NULL;
+}
@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_WAVEENGINEBATCH_HPP
+#define WP_WAVEENGINEBATCH_HPP
+
+#include "wpstdinclude.h"
+
+#include "WaveEngine.hpp"
+#include "wpkernels.hpp"
+
+// Number of engines in a group. Each analyzer of a group has a tracker lane.
+#define WP_BATCH_GROUP_SIZE (WP_TRACKER_LANES / 2)
+
+// Processes many engines in one pass, for renderers that run an instance per voice or file.
+// The engines are split into groups of WP_BATCH_GROUP_SIZE, and the amplitude followers, gates
+// and crossing triggers of a group's analyzers are stepped side by side with trackLanes. The
+// rest (the work done once per cycle, the synthesizers and the output modulators) still runs
+// per engine, on whole blocks. Analyzers in kTriggerYin mode are stepped on their own.
+// Each engine keeps its own processing blocks, including silence skipping, so the output is
+// the same as that of the engine's own processReplacing.
+// NOTE: The engines are not owned. Their settings must not change during a process call.
+class WaveEngineBatch {
+private:
+	struct Group {
+		WaveEngine *engines[WP_BATCH_GROUP_SIZE];
+		int nEngines;
+		TrackerLanes lanes;
+	};
+	
+	Group *groups;
+	int nEngines, nGroups;
+	
+	// Input frames interleavedStart to interleavedEnd - 1 of the group being processed, with
+	// the samples of the tracker lanes side by side.
+	float interleaved[WP_PROC_BLOCK_SIZE * WP_TRACKER_LANES];
+	int interleavedStart, interleavedEnd;
+	
+public:
+	WaveEngineBatch();
+	~WaveEngineBatch();
+	
+	// Sets the n engines to process. Returns false if the groups couldn't be allocated,
+	// leaving no engines.
+	bool setEngines(WaveEngine *const *engines, int n);
+	int getNumEngines() {return nEngines;}
+	
+	// Replacing processing of every engine, as set up by its setProcessMode. Engine k
+	// processes in0[k] and in1[k] into out0[k] and out1[k]. in1 may be NULL if no engine is
+	// set up for two inputs, and out1 if none is set up for two outputs. Engines that aren't
+	// operational output nothing.
+	void processReplacing(
+		float *const *in0, float *const *in1, float *const *out0, float *const *out1,
+		int sampleFrames);
+	
+private:
+	void processGroup(
+		Group &group, float *const *in0, float *const *in1, float *const *out0, float *const *out1,
+		int sampleFrames);
+	
+	// Steps the active lanes through frames pos to pos + n - 1 of their inputs, which are
+	// sampleFrames long. Lanes without an input get silence.
+	void trackStep(
+		TrackerLanes &lanes, Analyzer *const *analyzers, const float *const *inputs, int pos, int n,
+		int sampleFrames);
+	
+	// Makes lane l an inactive, gated lane that nothing can open.
+	static void clearLane(TrackerLanes &lanes, int l);
+};
+
+#endif
@@ -23,63 +23,40 @@ DEALINGS IN THE SOFTWARE.
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <new>
 #include <stdexcept>
+#include "wpfpu.hpp"
 #include "wpfunc.hpp"
 #ifndef WP_NO_GUI
 #include "WavePlugEditor.hpp"
 #endif
-
-// Parameter transform macros.
-#define BUFFER_SIZE_T(v) (1 << (int) (7.0f*(v) + 0.5f))
-
-#define INC_LAG_T(v) (std::pow(std::log10(9.0f*(v) + 1.0f), 0.2f))
-#define DEC_LAG_T(v) (std::pow(std::log10(9.0f*(v) + 1.0f), 0.01f))
-#define A_GATE_LVL_T(v) ((std::pow(2.0f, 12.0f*(v)) - 1.0f)/4095.0f)
-#define S_GATE_LVL_T(v) A_GATE_LVL_T(v)
-#define TRIG_LVL_T(v) (3.0f*((v)-0.5f))
-#define F_MIN_T(v) ((globalMaxFrequency - 1.0f)*(std::pow(2.0f, 9.0f*(v)) - 1.0f)/511.0f + 1.0f)
-#define F_MAX_T(v) F_MIN_T(v)
-#define F_LAG_T(v) (std::pow(std::log10(9.0f*(v) + 1.0f), 0.4f))
-#define W_LAG_T(v) F_LAG_T(v)
-#define BOOL_T(v) ((v) > 0.5f)
-#define U_MOD_TYPE_T(v) ((ModulationTypeU) (unsigned int) (0.999f*((v)*kNModTypesU)))
-#define F_MOD_TYPE_T(v) ((ModulationTypeF) (unsigned int) (0.999f*((v)*kNModTypesF)))
-#define A_OFFSET_T(v) (2.0f*((v)-0.5f))
-#define A_GAIN_T(v) (((v) > 0.5f) \
-                     ? ((((v) > 0.9999f)) ? 5000.0f : 1.0f / (2.0f*(1.0f - (v)))) \
-                     : 2.0f*(v))
-#define F_OFFSET_T(v) (((v) > 0.5f) \
-                       ? (std::pow(2.0f, 32.0f*((v)-0.5f)) - 1.0f)/65535.0f \
-                       : -(std::pow(2.0f, 32.0f*(0.5f-(v))) - 1.0f)/65535.0f)
-#define F_GAIN_T(v) (((v) > 0.5f) \
-                     ? ((((v) > 0.9999f)) ? 5000.0f : 1.0f / (2.0f*(1.0f - (v)))) \
-                     : 2.0f*(v))
-#define OVER_T(v) (1 + (int) (15.0f*(v)))
-#define WINDOW_T(v) ((int) (250.0f*(v)))
-#define S_MOD_TYPE_T(v) ((ModulationTypeS) (unsigned int) (0.999f*((v)*kNModTypesS)))
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #define M_LN2 0.69314718055994530942
 
-// Macro for standard processing method.
-#define PROC_METHOD(ioStatements) \
-(float *in0, float *in1, float *out0, float *out1, int sampleFrames) { \
-	while (--sampleFrames >= 0) { \
-		{ioStatements} \
-		syn1.tick(); syn2.tick(); \
-	} \
+// Index of lowest set bit. The argument must not be 0.
+#if defined(__GNUC__)
+#define LOWEST_BIT(flags) __builtin_ctz(flags)
+#elif defined(_MSC_VER)
+static inline int LOWEST_BIT(unsigned int flags) {
+	unsigned long index;
+	_BitScanForward(&index, flags);
+	return (int) index;
+}
+#else
+static inline int LOWEST_BIT(unsigned int flags) {
+	int index = 0;
+	for (; !(flags & 1u); flags >>= 1)
+		index++;
+	return index;
 }
+#endif
 
 // Private static data.
-const char *const WavePlug::paramNames[kNumParams] = {
-	"AIncLag", "ADecLag", "GatLvlA", "GatLvlS", "HiTrig", "LowTrig",
-	"FMin", "FMax", "FLag", "WLag", "InvTrig", "Interp",
-	"AModTyp", "AModMix", "FModTyp", "FModMix", "WModTyp", "WModMix",
-	"AOffset", "AGain", "FOffset", "FGain", "Oversmp", "SmooWin",
-	"OModTyp", "OModMix"
-};
-
 const char *const WavePlug::paramLabels[kNumParams] = {
 	"%", "%", "%", "%", "%", "%",
 	"Hz", "Hz", "%", "%", "", "",
@@ -219,15 +196,6 @@ const char *const WavePlug::modFuncFHelpTexts[kNModTypesF][2] = {
 	}
 };
 
-const float WavePlug::initParamValues[kNumParams] = {
-	0.1f, 0.8f, 0.05f, 0.75f, 0.783f, 0.217f, 0.00055f, 0.73f, 0.0f, 0.0f, 0.0f, 1.0f,
-	0.0f, 0.0f,
-	0.0f, 0.0f,
-	0.0f, 0.0f,
-	0.5f, 0.5f, 0.5f, 0.5f, 0.0f, 0.0f,
-	0.0f, 0.0f
-};
-
 const WavePlug::funcfcp WavePlug::paramDisplayers[kNumParams] = {
 	&WavePlug::aIncLagDisplayer,
 	&WavePlug::aDecLagDisplayer,
@@ -262,67 +230,6 @@ const WavePlug::funcfcp WavePlug::paramDisplayers[kNumParams] = {
 	&WavePlug::pcntDisplayer
 };
 
-const WavePlug::methodf WavePlug::paramSetters[kNumParams] = {
-	&WavePlug::aAIWSetter,
-	&WavePlug::aADWSetter,
-	&WavePlug::aAGLSetter,
-	&WavePlug::aSGLSetter,
-	&WavePlug::aFHTSetter,
-	&WavePlug::aFLTSetter,
-	&WavePlug::aFMinSetter,
-	&WavePlug::aFMaxSetter,
-	&WavePlug::aFWSetter,
-	&WavePlug::aWWSetter,
-	&WavePlug::aITSetter,
-	&WavePlug::aWISetter,
-	
-	&WavePlug::mAModSetter,
-	&WavePlug::mAMixSetter,
-	
-	&WavePlug::mFModSetter,
-	&WavePlug::mFMixSetter,
-	
-	&WavePlug::mWModSetter,
-	&WavePlug::mWMixSetter,
-	
-	&WavePlug::sAOffSetter,
-	&WavePlug::sAGainSetter,
-	&WavePlug::sFOffSetter,
-	&WavePlug::sFGainSetter,
-	&WavePlug::sOverSetter,
-	&WavePlug::sWindSetter,
-	
-	&WavePlug::mOModSetter,
-	&WavePlug::mOMixSetter
-};
-
-const WavePlug::method4fpi WavePlug::procHandlers[9] = {
-	&WavePlug::proc1In1Out,
-	&WavePlug::proc1In1OutB,
-	&WavePlug::proc1In2Out,
-	&WavePlug::proc1In2OutB,
-	&WavePlug::proc2In1Out,
-	&WavePlug::proc2In1OutB,
-	&WavePlug::proc2In2Out,
-	&WavePlug::proc2In2OutB,
-	
-	&WavePlug::procDoNothing // Fallback handler for error states.
-};
-
-const WavePlug::method4fpi WavePlug::procRHandlers[9] = {
-	&WavePlug::procR1In1Out,
-	&WavePlug::procR1In1OutB,
-	&WavePlug::procR1In2Out,
-	&WavePlug::procR1In2OutB,
-	&WavePlug::procR2In1Out,
-	&WavePlug::procR2In1OutB,
-	&WavePlug::procR2In2Out,
-	&WavePlug::procR2In2OutB,
-	
-	&WavePlug::procDoNothing // Fallback handler for error states.
-};
-
-
 // Displayers.
 void WavePlug::bufferSizeDisplayer(float value, char *text) {
 	std::sprintf(text, "%i", BUFFER_SIZE_T(value));
@@ -332,7 +239,7 @@ void WavePlug::bufferSizeKByteDisplayer(float value, char *text) {
 	int multiplier = BUFFER_SIZE_T(value);
 	float sRateModifier = globalSampleRate / WP_STD_SAMPLE_RATE;
 	int kBytes = (int) (sizeof(float) * 2.0f * multiplier * sRateModifier *
-	                    (2.0f * WP_ANA_BUFFER_SIZE + 1.5f * WP_SYN_BUFFER_SIZE) / 1024.0f);
+	                    (3.0f * WP_ANA_BUFFER_SIZE + 1.5f * WP_SYN_BUFFER_SIZE) / 1024.0f);
 	std::sprintf(text, "%i", kBytes);
 }
 
@@ -428,7 +335,7 @@ void WavePlug::smoothingWinDisplayer(float value, char *text) {
 
 // Constructor.
 WavePlug::WavePlug(audioMasterCallback audioMaster) :
-	AudioEffectX(audioMaster, 1, kNumAllParams), BufferManager()
+	AudioEffectX(audioMaster, 1, kNumAllParams)
 {
 	// NOTE: This critical section visit is only meaningful on a multiprocessor.
 	// It ensures that the initial values stored in the memory locations
@@ -436,7 +343,7 @@ WavePlug::WavePlug(audioMasterCallback audioMaster) :
 	// are seen by all threads. (There might have been something in
 	// that part of the address space before the constructor was called
 	// and parts of the old data might still be cached by some processors.)
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	// Set plugin properties.
 	setNumInputs(2); // Stereo in.
@@ -461,17 +368,11 @@ WavePlug::WavePlug(audioMasterCallback audioMaster) :
 	sharedData.bypassedFlag = false;
 	sharedData.input0Connected = sharedData.output0Connected = 1;
 	sharedData.input1Connected = sharedData.output1Connected = 0;
-	sharedData.bufferSizeMultiplier = 1;
+	bufferSizeMultiplier = 1;
 	
 	// Set initial parameter and signal monitor values.
-	sharedData.paramValues[kPlugVersion] = 0.0f;
-	sharedData.paramValues[kBufferSize] = 2.0f / 7.0f;
-	std::memcpy(
-		sharedData.paramValues + kNumMonoParams,
-		initParamValues, kNumParams * sizeof (float));
-	std::memcpy(
-		sharedData.paramValues + kNumMonoParams + kNumParams,
-		initParamValues, kNumParams * sizeof (float));
+	for (int i = 0; i < kNumAllParams; i++)
+		paramValues[i] = WaveEngine::getInitParamValue(i);
 	
 	sharedData.preA1 = sharedData.postA1 = sharedData.preF1 = sharedData.postF1 =
 	sharedData.preA2 = sharedData.postA2 = sharedData.preF2 = sharedData.postF2 = 0.0f;
@@ -481,8 +382,21 @@ WavePlug::WavePlug(audioMasterCallback audioMaster) :
 	sharedData.resetFlag = false;
 	sharedData.setProcessHandlersFlag = false;
 	sharedData.newSampleRate = NAN;
-	std::memcpy(
-		sharedData.newParamValues, sharedData.paramValues, kNumAllParams * sizeof (float));
+	
+	// Hand over all initial parameter values.
+	std::fill(newParamFlags, newParamFlags + WP_PARAM_FLAG_WORDS, 0u);
+	
+	for (int i = 0; i < kNumAllParams; i++) {
+		newParamValues[i] = paramValues[i].load();
+		newParamFlags[i / 32] |= 1u << (i % 32);
+	}
+	
+	// The processing thread has nothing to do until it has taken the first update.
+	processingData = sharedData;
+	processingData.operational = false;
+	processingData.clearUpdateFields();
+	std::fill(paramUpdateFlags, paramUpdateFlags + WP_PARAM_FLAG_WORDS, 0u);
+	in0Index = in1Index = out0Index = out1Index = 0;
 	
 	// Create GUI editor (if GUI build).
 	editor = NULL;
@@ -497,19 +411,19 @@ WavePlug::WavePlug(audioMasterCallback audioMaster) :
 #endif
 	
 	// Done.
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 }
 
 WavePlug::~WavePlug() {
 #ifndef WP_NO_GUI
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	// NOTE: ~AudioEffect will delete the editor if it exists.
 	// I do it myself here for thread safety.
 	delete editor;
 	editor = NULL;
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 #endif
 }
 
@@ -560,32 +474,32 @@ VstInt32 WavePlug::canDo(char *text) {
 void WavePlug::setProgram(VstInt32 program) {} // No program changes allowed.
 
 void WavePlug::setProgramName(char *name) { // SYNCHRONIZED
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	std::strcpy(programName, name);
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 }
 
 void WavePlug::getProgramName(char *name) { // SYNCHRONIZED
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	std::strcpy(name, programName);
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 }
 
 bool WavePlug::getProgramNameIndexed(VstInt32 category, VstInt32 index, char *text) { // SYNCHRONIZED
 	bool success = false;
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	if ((category == 0 || category == -1) && index == 0) {
 		std::strcpy(text, programName);
 		success = true;
 	}
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	return success;
 }
@@ -613,10 +527,12 @@ void WavePlug::setParameter(VstInt32 index, float value) { // SYNCHRONIZED
 		break;
 	}
 	
-	// Set new parameter value (and help texts).
-	EnterCriticalSection(&myCriticalSection);
+	// Hand over new parameter value. This doesn't need the lock.
+	newParamValues[index].store(value, std::memory_order_relaxed);
+	newParamFlags[index / 32].fetch_or(1u << (index % 32), std::memory_order_release);
 	
-	sharedData.newParamValues[index] = value;
+	// Set new help texts.
+	myCriticalSection.enter();
 	
 	if (texts != NULL) { // Modulator function parameter updated.
 		paramHelpTexts[index] = texts[0];
@@ -628,19 +544,11 @@ void WavePlug::setParameter(VstInt32 index, float value) { // SYNCHRONIZED
 		((AEffGUIEditor *) editor)->setParameter(index, value);
 #endif
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 }
 
-float WavePlug::getParameter(VstInt32 index) { // SYNCHRONIZED
-	float value = NAN;
-	
-	EnterCriticalSection(&myCriticalSection);
-	
-	value = sharedData.paramValues[index];
-	
-	LeaveCriticalSection(&myCriticalSection);
-	
-	return value;
+float WavePlug::getParameter(VstInt32 index) {
+	return paramValues[index].load(std::memory_order_relaxed);
 }
 
 void WavePlug::getParameterName(VstInt32 index, char *label) {
@@ -653,7 +561,7 @@ void WavePlug::getParameterName(VstInt32 index, char *label) {
 	else {
 		index -= kNumMonoParams;
 		
-		std::strcpy(label, paramNames[index % kNumParams]);
+		std::strcpy(label, WaveEngine::paramNames[index % kNumParams]);
 		std::strcat(label, (index < kNumParams) ? "1" : "2");
 	}
 }
@@ -685,36 +593,46 @@ void WavePlug::getParameterLabel(VstInt32 index, char *label) {
 }
 
 void WavePlug::setSampleRate(float sRate) { // SYNCHRONIZED
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	sharedData.newSampleRate = sRate;
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 }
 
 bool WavePlug::setBypass(bool onOff) { // SYNCHRONIZED
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	sharedData.bypassedFlag = onOff;
 	sharedData.setProcessHandlersFlag = true;
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	return true;
 }
 
 void WavePlug::suspend() { // SYNCHRONIZED
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	sharedData.resetFlag = true;
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
+	
+#ifdef WP_PROFILE
+	// Profiling builds dump to $LOSTTECH_PROFILE.<instance address> whenever they're suspended.
+	const char *profilePath = std::getenv("LOSTTECH_PROFILE");
+	if (profilePath != NULL) {
+		char path[1024];
+		std::snprintf(path, sizeof path, "%s.%p", profilePath, (void *) this);
+		dumpProfile(path);
+	}
+#endif
 }
 
 void WavePlug::resume() { // SYNCHRONIZED
 	bool noInputs = false, noOutputs = false;
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	sharedData.resetFlag = true;
 	sharedData.setProcessHandlersFlag = true;
@@ -734,7 +652,7 @@ void WavePlug::resume() { // SYNCHRONIZED
 		noOutputs = true;
 	}
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	if (noInputs & noOutputs)
 		throw std::runtime_error("WavePlug::resume - No inputs or outputs connected.");
@@ -747,15 +665,20 @@ void WavePlug::resume() { // SYNCHRONIZED
 /*void WavePlug::process(float **inputs, float **outputs, long sampleFrames) {
 	doThreadSynchronizedDataExchange();
 	
-	(this->*procHandler)(
-		inputs[in0Index], inputs[in1Index], outputs[out0Index], outputs[out1Index], sampleFrames);
+	if (processingData.operational)
+		engine.process(
+			inputs[in0Index], inputs[in1Index], outputs[out0Index], outputs[out1Index], sampleFrames);
 }*/
 
 void WavePlug::processReplacing(float **inputs, float **outputs, VstInt32 sampleFrames) {
+	DenormalGuard denormalGuard;
+	WP_PROFILE_BLOCK(&profiler, sampleFrames, globalSampleRate);
+	
 	doThreadSynchronizedDataExchange();
 	
-	(this->*procRHandler)(
-		inputs[in0Index], inputs[in1Index], outputs[out0Index], outputs[out1Index], sampleFrames);
+	if (processingData.operational)
+		engine.processReplacing(
+			inputs[in0Index], inputs[in1Index], outputs[out0Index], outputs[out1Index], sampleFrames);
 }
 
 
@@ -763,11 +686,11 @@ void WavePlug::processReplacing(float **inputs, float **outputs, VstInt32 sample
 const char *WavePlug::getParamHelpText(int index) { // SYNCHRONIZED
 	const char *helpText = "";
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	helpText = paramHelpTexts[index];
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	return helpText;
 }
@@ -775,7 +698,7 @@ const char *WavePlug::getParamHelpText(int index) { // SYNCHRONIZED
 float WavePlug::getAmplitude(int channel, bool postmod) { // SYNCHRONIZED
 	float value = NAN;
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	value = (channel == 0)
 		? ((postmod) ? sharedData.postA1 : sharedData.preA1)
@@ -783,7 +706,7 @@ float WavePlug::getAmplitude(int channel, bool postmod) { // SYNCHRONIZED
 			? ((postmod) ? sharedData.postA2 : sharedData.preA2)
 	    : 0.0f);
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	return value;
 }
@@ -791,7 +714,7 @@ float WavePlug::getAmplitude(int channel, bool postmod) { // SYNCHRONIZED
 float WavePlug::getFrequency(int channel, bool postmod) { // SYNCHRONIZED
 	float value = NAN;
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	value = (channel == 0)
 		? ((postmod) ? sharedData.postF1 : sharedData.preF1)
@@ -799,7 +722,7 @@ float WavePlug::getFrequency(int channel, bool postmod) { // SYNCHRONIZED
 			? ((postmod) ? sharedData.postF2 : sharedData.preF2)
 	    : 0.0f);
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	return value;
 }
@@ -807,35 +730,27 @@ float WavePlug::getFrequency(int channel, bool postmod) { // SYNCHRONIZED
 bool WavePlug::isOperational() { // SYNCHRONIZED
 	bool flag = false;
 	
-	EnterCriticalSection(&myCriticalSection);
+	myCriticalSection.enter();
 	
 	flag = sharedData.operational;
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 	
 	return flag;
 }
 
-int WavePlug::getBufferSizeMultiplier() { // SYNCHRONIZED
-	int multiplier = -1;
-	
-	EnterCriticalSection(&myCriticalSection);
-	
-	multiplier = sharedData.bufferSizeMultiplier;
-	
-	LeaveCriticalSection(&myCriticalSection);
-	
-	return multiplier;
+int WavePlug::getBufferSizeMultiplier() {
+	return bufferSizeMultiplier.load(std::memory_order_relaxed);
 }
 
 
 // ---<<< PRIVATE METHODS BEGIN HERE >>>---
 void WavePlug::setOperational(bool flag) { // SYNCHRONIZED
-	EnterCriticalSection(&myCriticalSection);
+	enterOnProcessingThread();
 	
 	sharedData.operational = flag;
 	
-	LeaveCriticalSection(&myCriticalSection);
+	myCriticalSection.leave();
 }
 
 void WavePlug::WavePlugData::clearUpdateFields() {
@@ -844,31 +759,42 @@ void WavePlug::WavePlugData::clearUpdateFields() {
 	setProcessHandlersFlag = false;
 	
 	newSampleRate = NAN;
+}
+
+void WavePlug::enterOnProcessingThread() {
+	WP_PROFILE_PROBE(kProbeLockWait);
 	
-	std::fill(newParamValues, newParamValues + kNumAllParams, NAN);
+	myCriticalSection.enter();
 }
 
 void WavePlug::doThreadSynchronizedDataExchange() {
-	
-	EnterCriticalSection(&myCriticalSection);
-	
-	// Update signal monitors.
-	if (sharedData.operational & !sharedData.reinitFlag) {
-		sharedData.preA1 = ana1.getAmplitude();
-		sharedData.postA1 = syn1.getAmplitude();
-		sharedData.preF1 = ana1.getFrequency();
-		sharedData.postF1 = syn1.getFrequency();
-		sharedData.preA2 = ana2.getAmplitude();
-		sharedData.postA2 = syn2.getAmplitude();
-		sharedData.preF2 = ana2.getFrequency();
-		sharedData.postF2 = syn2.getFrequency();
+	WP_PROFILE_PROBE(kProbeDataExchange);
+	
+	// NOTE: The processing thread never waits for the lock. If another thread holds it,
+	// the shared structure is exchanged on a later call instead.
+	if (myCriticalSection.tryEnter()) {
+		// Update signal monitors.
+		if (sharedData.operational & !sharedData.reinitFlag) {
+			sharedData.preA1 = engine.getAmplitude(0);
+			sharedData.postA1 = engine.getAmplitude(0, true);
+			sharedData.preF1 = engine.getFrequency(0);
+			sharedData.postF1 = engine.getFrequency(0, true);
+			sharedData.preA2 = engine.getAmplitude(1);
+			sharedData.postA2 = engine.getAmplitude(1, true);
+			sharedData.preF2 = engine.getFrequency(1);
+			sharedData.postF2 = engine.getFrequency(1, true);
+		}
+		
+		// Copy shared structure to thread-private structure.
+		processingData = sharedData;
+		sharedData.clearUpdateFields();
+		
+		myCriticalSection.leave();
+	}
+	else {
+		processingData.clearUpdateFields(); // Updates were handled last time.
+		WP_PROFILE_LOCK_MISS();
 	}
-	
-	// Copy shared structure to thread-private structure.
-	processingData = sharedData;
-	sharedData.clearUpdateFields();
-	
-	LeaveCriticalSection(&myCriticalSection);
 	
 	// Update plugin configuration.
 	if (processingData.reinitFlag) {
@@ -882,73 +808,45 @@ void WavePlug::doThreadSynchronizedDataExchange() {
 	if (!processingData.operational) // SYSTEM ATE SHIT.
 		return;
 	
-	if (processingData.resetFlag) {
-		ana1.reset();
-		ana2.reset();
-		syn1.reset();
-		syn2.reset();
-	}
+	if (processingData.resetFlag)
+		engine.reset();
 	
 	if (!std::isnan(processingData.newSampleRate)) {
-		float oldSampleRate = globalSampleRate;
-		
-		setGlobalSampleRate(processingData.newSampleRate);
-		
-		if (setBufferSizeMultiplier(processingData.bufferSizeMultiplier)) {
-			EnterCriticalSection(&myCriticalSection);
+		if (engine.setSampleRate(processingData.newSampleRate)) {
+			enterOnProcessingThread();
 			
 			AudioEffectX::setSampleRate(processingData.newSampleRate);
 			
-			LeaveCriticalSection(&myCriticalSection);
+			myCriticalSection.leave();
 		}
-		else if (processingData.operational) // Old buffer size restored.
-			setGlobalSampleRate(oldSampleRate);
-		else { // Sample buffers unrecoverably lost.
-			setProcHandlers(); // Set emergency handlers.
+		else if (!engine.isOperational()) { // Sample buffers unrecoverably lost.
+			processingData.operational = false;
 			setOperational(false);
 			return;
 		}
 	}
 	
-	// Perform parameter updates. Write back new param values to shared structure.
-	if (doParameterUpdates() > 0) {
-		EnterCriticalSection(&myCriticalSection);
-		
-		std::memcpy(
-			sharedData.paramValues, processingData.paramValues, sizeof sharedData.paramValues);
-		sharedData.bufferSizeMultiplier = processingData.bufferSizeMultiplier;
-		
-		LeaveCriticalSection(&myCriticalSection);
-	}
-	else if (!processingData.operational) { // Unrecoverable error.
-		setProcHandlers(); // Set emergency handlers.
+	// Perform parameter updates.
+	takeParameterUpdates();
+	
+	if (doParameterUpdates() < 0) { // Unrecoverable error.
+		processingData.operational = false;
 		setOperational(false);
 	}
 }
 
 bool WavePlug::reinitialize() {
-	// Processing components.
-	ana1.initialize(this);
-	ana2.initialize(this);
-	modA1.initialize(ana1.getAmpFunction(), ana2.getAmpFunction());
-	modA2.initialize(ana2.getAmpFunction(), ana1.getAmpFunction());
-	modF1.initialize(ana1.getFreqFunction(), ana2.getFreqFunction(), hzToUnsigned(261.63f));
-	modF2.initialize(ana2.getFreqFunction(), ana1.getFreqFunction(), hzToUnsigned(261.63f));
-	modW1.initialize(ana1.getWaveFunction(), ana2.getWaveFunction());
-	modW2.initialize(ana2.getWaveFunction(), ana1.getWaveFunction());
-	syn1.initialize(this, &modA1, &modF1, &modW1);
-	syn2.initialize(this, &modA2, &modF2, &modW2);
-	modO1.initialize(syn1.getAudioFunction(), syn2.getAudioFunction());
-	modO2.initialize(syn2.getAudioFunction(), syn1.getAudioFunction());
-	
-	// Attempt to allocate minimal sample buffers.
-	if (setBufferSizeMultiplier(processingData.bufferSizeMultiplier)) {
+	// Processing components and minimal sample buffers.
+	if (engine.initialize(bufferSizeMultiplier.load(std::memory_order_relaxed))) {
 		// Set initial parameter values in components.
-		editMode = -1; // NOT 0 or 1.
-		doParameterUpdates(); // MUST be called AFTER editMode initialization.
+		takeParameterUpdates();
+		doParameterUpdates();
+		
+		// Ramp later parameter changes. The initial values apply at once.
+		engine.setRampTime(WP_PARAM_RAMP_TIME);
 	}
-	else
-		processingData.operational = false;
+	
+	processingData.operational = processingData.operational & engine.isOperational();
 	
 	// Set initial processing handlers.
 	setProcHandlers();
@@ -957,146 +855,58 @@ bool WavePlug::reinitialize() {
 }
 
 
-// Setters.
-int WavePlug::doParameterUpdates() {
-	int nUpdated = 0;
-	
-	for (int index = 0; index < kNumAllParams; index++) {
-		if (std::isnan(processingData.newParamValues[index])) // Parameter not updated.
-			continue;
-		else if (index < kNumMonoParams) {
-			// Ignore attempts to set the "PlugVersion" dummy parameter.
-			
-			if (index == kBufferSize) {
-				if (setBufferSizeMultiplier(BUFFER_SIZE_T(processingData.newParamValues[index]))) {
-					processingData.paramValues[index] = processingData.newParamValues[index];
-					
-					nUpdated++;
-				}
-				else if (!processingData.operational) // Sample buffers unrecoverably lost.
-					return -1;
-			}
-		}
-		else {
-			long stereoIndex = index - kNumMonoParams;
-			
-			setEditMode((stereoIndex < kNumParams) ? 0 : 1);
-			
-			(this->*paramSetters[stereoIndex % kNumParams])(processingData.newParamValues[index]);
-			processingData.paramValues[index] = processingData.newParamValues[index];
+// Parameter updates.
+void WavePlug::takeParameterUpdates() {
+	for (int word = 0; word < WP_PARAM_FLAG_WORDS; word++) {
+		unsigned int flags = newParamFlags[word].exchange(0u, std::memory_order_acquire);
+		
+		paramUpdateFlags[word] |= flags;
+		
+		// NOTE: A value stored after the exchange may be loaded here too. Its flag is
+		// then still set, so it is just applied once more on the next call.
+		for (; flags != 0u; flags &= flags - 1u) {
+			int index = 32 * word + LOWEST_BIT(flags);
 			
-			nUpdated++;
+			paramUpdates[index] = newParamValues[index].load(std::memory_order_relaxed);
 		}
 	}
-	
-	return nUpdated;
 }
 
-bool WavePlug::setBufferSizeMultiplier(int multiplier) {
-	int anaSize = (int) (multiplier * (WP_ANA_BUFFER_SIZE * globalSampleRate) / WP_STD_SAMPLE_RATE),
-			synSize = (int) (multiplier * (WP_SYN_BUFFER_SIZE * globalSampleRate) / WP_STD_SAMPLE_RATE),
-			oldAnaSize = ana1.getBufferSize(),
-			oldSynSize = syn1.getBufferSize();
+int WavePlug::doParameterUpdates() {
+	int nUpdated = 0;
 	
-	if (!(ana1.setBufferSize(anaSize) && ana2.setBufferSize(anaSize) &&
-				syn1.setBufferSize(synSize) && syn2.setBufferSize(synSize))) {
+	// NOTE: Updated parameters are visited in index order. Channel 1 parameters come before
+	// channel 2 parameters, so the engine changes edit mode at most twice.
+	for (int word = 0; word < WP_PARAM_FLAG_WORDS; word++) {
+		unsigned int flags = paramUpdateFlags[word];
 		
-		if (!(ana1.setBufferSize(oldAnaSize) && ana2.setBufferSize(oldAnaSize) &&
-					syn1.setBufferSize(oldSynSize) && syn2.setBufferSize(oldSynSize)))
-			processingData.operational = false;
+		paramUpdateFlags[word] = 0u;
 		
-		return false;
+		for (; flags != 0u; flags &= flags - 1u) {
+			int index = 32 * word + LOWEST_BIT(flags);
+			float value = paramUpdates[index];
+			
+			if (engine.setParameter(index, value)) {
+				paramValues[index].store(value, std::memory_order_relaxed);
+				
+				nUpdated++;
+			}
+			else if (!engine.isOperational()) // Sample buffers unrecoverably lost.
+				return -1;
+		}
 	}
 	
-	processingData.bufferSizeMultiplier = multiplier;
-	return true;
-}
-
-void WavePlug::setEditMode(int mode) {
-	if (mode == 0 && editMode != 0) {
-		editMode = 0;
-		
-		anaE  = &ana1;
-		modAE = &modA1;
-		modFE = &modF1;
-		modWE = &modW1;
-		synE  = &syn1;
-		modOE = &modO1;
-	}
-	else if (mode == 1 && editMode != 1) {
-		editMode = 1;
-		
-		anaE  = &ana2;
-		modAE = &modA2;
-		modFE = &modF2;
-		modWE = &modW2;
-		synE  = &syn2;
-		modOE = &modO2;
-	}
+	bufferSizeMultiplier.store(engine.getBufferSizeMultiplier(), std::memory_order_relaxed);
+	return nUpdated;
 }
 
-void WavePlug::aAIWSetter(float value) {anaE->setAIncWeight(INC_LAG_T(value));}
-
-void WavePlug::aADWSetter(float value) {anaE->setADecWeight(DEC_LAG_T(value));}
-
-void WavePlug::aAGLSetter(float value) {anaE->setAmpGateLevel(A_GATE_LVL_T(value));}
-
-void WavePlug::aSGLSetter(float value) {anaE->setSampleGateLevel(S_GATE_LVL_T(value));}
-
-void WavePlug::aFHTSetter(float value) {anaE->setHighTrig(TRIG_LVL_T(value));}
-
-void WavePlug::aFLTSetter(float value) {anaE->setLowTrig(TRIG_LVL_T(value));}
-
-void WavePlug::aFMinSetter(float value) {anaE->setFMin(F_MIN_T(value));}
-
-void WavePlug::aFMaxSetter(float value) {anaE->setFMax(F_MAX_T(value));}
-
-void WavePlug::aFWSetter(float value) {anaE->setFWeight(F_LAG_T(value));}
-
-void WavePlug::aWWSetter(float value) {anaE->setWWeight(W_LAG_T(value));}
-
-void WavePlug::aITSetter(float value) {anaE->setTrigInverted(BOOL_T(value));}
-
-void WavePlug::aWISetter(float value) {anaE->setWInterpolation(BOOL_T(value));}
-
-void WavePlug::mAModSetter(float value) {modAE->setModulation(U_MOD_TYPE_T(value));}
-
-void WavePlug::mAMixSetter(float value) {modAE->setMix(value);}
-
-void WavePlug::mFModSetter(float value) {modFE->setModulation(U_MOD_TYPE_T(value));}
-
-void WavePlug::mFMixSetter(float value) {modFE->setMix(value);}
-
-void WavePlug::mWModSetter(float value) {modWE->setModulation(F_MOD_TYPE_T(value));}
-
-void WavePlug::mWMixSetter(float value) {modWE->setMix(value);}
-
-void WavePlug::sAOffSetter(float value) {synE->setAOffset(A_OFFSET_T(value));}
-
-void WavePlug::sAGainSetter(float value) {synE->setAGain(A_GAIN_T(value));}
-
-void WavePlug::sFOffSetter(float value) {synE->setFOffset(F_OFFSET_T(value));}
-
-void WavePlug::sFGainSetter(float value) {synE->setFGain(F_GAIN_T(value));}
-
-void WavePlug::sOverSetter(float value) {synE->setOversamplingMultiplier(OVER_T(value));}
-
-void WavePlug::sWindSetter(float value) {synE->setSmoothingWindow(WINDOW_T(value));}
-
-void WavePlug::mOModSetter(float value) {modOE->setModulation(S_MOD_TYPE_T(value));}
-
-void WavePlug::mOMixSetter(float value) {modOE->setMix(value);}
-
 
 // Processing handlers.
 void WavePlug::setProcHandlers() {
-	if (!processingData.operational) { // Unrecoverable error.
-		procHandler = procHandlers[8]; // Use do-nothing handlers.
-		procRHandler = procRHandlers[8];
-		return;
-	}
+	if (!processingData.operational) // Unrecoverable error.
+		return; // processReplacing does nothing.
 	
-	int handlerIndex = 0;
+	int nInputs = 1, nOutputs = 1;
 	
 	switch (processingData.input1Connected << 1 | processingData.input0Connected) {
 		case 1: // !in1 in0
@@ -1109,7 +919,7 @@ void WavePlug::setProcHandlers() {
 		
 		case 3: // in1 in0
 		in1Index = 1; in0Index = 0;
-		handlerIndex += 4; // Two inputs.
+		nInputs = 2;
 		break;
 	}
 	
@@ -1124,101 +934,9 @@ void WavePlug::setProcHandlers() {
 		
 		case 3: // out1 out0
 		out1Index = 1; out0Index = 0;
-		handlerIndex += 2; // Two outputs.
+		nOutputs = 2;
 		break;
 	}
 	
-	if (processingData.bypassedFlag)
-		handlerIndex += 1; // Bypass mode.
-	
-	procHandler = procHandlers[handlerIndex];
-	procRHandler = procRHandlers[handlerIndex];
+	engine.setProcessMode(nInputs == 2, nOutputs == 2, processingData.bypassedFlag);
 }
-
-void WavePlug::proc1In1Out PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in0++);
-	*out0++ += modO1.getValue();)
-
-void WavePlug::proc1In1OutB PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in0);
-	*out0++ += *in0++;)
-
-void WavePlug::proc1In2Out PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in0++);
-	*out0++ += modO1.getValue();
-	*out1++ += modO2.getValue();)
-
-void WavePlug::proc1In2OutB PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in0);
-	*out0++ += *in0;
-	*out1++ += *in0++;)
-
-void WavePlug::proc2In1Out PROC_METHOD(
-	ana1.addSample(*in0++);
-	ana2.addSample(*in1++);
-	*out0++ += modO1.getValue();)
-
-void WavePlug::proc2In1OutB PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in1++);
-	*out0++ += *in0++;)
-
-void WavePlug::proc2In2Out PROC_METHOD(
-	ana1.addSample(*in0++);
-	ana2.addSample(*in1++);
-	*out0++ += modO1.getValue();
-	*out1++ += modO2.getValue();)
-
-void WavePlug::proc2In2OutB PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in1);
-	*out0++ += *in0++;
-	*out1++ += *in1++;)
-
-void WavePlug::procR1In1Out PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in0++);
-	*out0++ = modO1.getValue();)
-
-void WavePlug::procR1In1OutB PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in0);
-	*out0++ = *in0++;)
-
-void WavePlug::procR1In2Out PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in0++);
-	*out0++ = modO1.getValue();
-	*out1++ = modO2.getValue();)
-
-void WavePlug::procR1In2OutB PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in0);
-	*out0++ = *in0;
-	*out1++ = *in0++;)
-
-void WavePlug::procR2In1Out PROC_METHOD(
-	ana1.addSample(*in0++);
-	ana2.addSample(*in1++);
-	*out0++ = modO1.getValue();)
-
-void WavePlug::procR2In1OutB PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in1++);
-	*out0++ = *in0++;)
-
-void WavePlug::procR2In2Out PROC_METHOD(
-	ana1.addSample(*in0++);
-	ana2.addSample(*in1++);
-	*out0++ = modO1.getValue();
-	*out1++ = modO2.getValue();)
-
-void WavePlug::procR2In2OutB PROC_METHOD(
-	ana1.addSample(*in0);
-	ana2.addSample(*in1);
-	*out0++ = *in0++;
-	*out1++ = *in1++;)
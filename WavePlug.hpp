@@ -23,13 +23,11 @@ DEALINGS IN THE SOFTWARE.
 
 #include "wpstdinclude.h"
 
-#include <windows.h>
+#include <atomic>
 #include "audioeffectx.h"
-#include "BufferManager.hpp"
-#include "Analyzer.hpp"
-#include "wpmodulators.hpp"
-#include "Synthesizer.hpp"
-#include "waveplugparams.h"
+#include "wpsync.hpp"
+#include "wpprofile.hpp"
+#include "WaveEngine.hpp"
 
 #define WP_MAJOR 0
 #define WP_MINOR 2
@@ -38,33 +36,23 @@ DEALINGS IN THE SOFTWARE.
 #define WP_STRINGIFY(arg) #arg
 #define WP_VERSION_STRING(ma, mi, u) WP_STRINGIFY(ma) "." WP_STRINGIFY(mi) "." WP_STRINGIFY(u)
 
-#define WP_ANA_BUFFER_SIZE 1250
-#define WP_SYN_BUFFER_SIZE 1250
+// Number of 32-bit words in the updated parameter bitmask.
+#define WP_PARAM_FLAG_WORDS ((kNumAllParams + 31) / 32)
 
-class WavePlug : public AudioEffectX, public BufferManager {
+class WavePlug : public AudioEffectX {
 public: // public typedefs
 	typedef void (*funcfcp)(float, char *);
 	
 private: // private typedefs
-	typedef void (WavePlug::*methodf)(float);
-	typedef void (WavePlug::*method4fpi)(float *, float *, float *, float *, int);
-	
 private: // private static data members
-	static const char *const paramNames[kNumParams];
 	static const char *const paramLabels[kNumParams];
 	static const char *const initParamHelpTexts[kNumParams];
 	static const char *const modFuncUHelpTexts[kNModTypesU][2];
 	static const char *const modFuncSHelpTexts[kNModTypesS][2];
 	static const char *const modFuncFHelpTexts[kNModTypesF][2];
 	
-	static const float initParamValues[kNumParams];
-	
-	// Displayers and setters.
+	// Displayers.
 	static const funcfcp paramDisplayers[kNumParams];
-	static const methodf paramSetters[kNumParams];
-	
-	// Processing handlers.
-	static const method4fpi procHandlers[9], procRHandlers[9];
 	
 public: // public static methods
 	// Displayers.
@@ -101,6 +89,7 @@ private: // private data members
 	// ---<<< ALL ACCESS MUST BE SYNCHRONIZED >>>---
 	
 	// NOTE: Mutable fields inherited from AudioEffectX also count as shared data.
+	CriticalSection myCriticalSection;
 	
 	// Plugin info. (Not touched by the processing thread.)
 	char programName[32];
@@ -111,35 +100,52 @@ private: // private data members
 		// Plugin configuration.
 		bool operational, bypassedFlag;
 		int input0Connected, input1Connected, output0Connected, output1Connected;
-		int bufferSizeMultiplier;
 		
-		// Parameter and signal monitor data.
-		float paramValues[kNumAllParams];
+		// Signal monitor data.
 		float preA1, postA1, preF1, postF1, preA2, postA2, preF2, postF2;
 		
 		// ---<<< Update fields (what the processing thread should change) >>>---
 		bool reinitFlag, resetFlag, setProcessHandlersFlag;
-		float newSampleRate, newParamValues[kNumAllParams];
+		float newSampleRate;
 		
 		void clearUpdateFields();
 		
 	} sharedData, processingData;
 	
+	// ---<<< Lock-free shared data                   >>>---
+	// ---<<< ACCESS ONLY AS DESCRIBED FOR EACH FIELD >>>---
+	
+	// Parameter handoff. These have several writers: setParameter may be called from the host
+	// and the editor threads at once, and the processing thread clears the flags.
+	// setParameter stores the new value and then sets the parameter's bit in newParamFlags with
+	// an atomic OR, so concurrent callers never lose each other's bits. When two callers set the
+	// same parameter, the last value stored wins. The processing thread takes the flags with an
+	// atomic exchange and then loads the flagged values. Only the processing thread clears bits.
+	std::atomic<float> newParamValues[kNumAllParams];
+	std::atomic<unsigned int> newParamFlags[WP_PARAM_FLAG_WORDS];
+	
+	// Current values. Written by the processing thread.
+	std::atomic<float> paramValues[kNumAllParams];
+	std::atomic<int> bufferSizeMultiplier;
+	
 	// ---<<< Private data of processing object           >>>---
 	// ---<<< ALL ACCESS MUST HAPPEN ON PROCESSING THREAD >>>---
 	
-	// Processing components.
-	Analyzer ana1, ana2, *anaE;
-	UnsignedModulator modA1, modA2, *modAE, modF1, modF2, *modFE;
-	FunctionModulator modW1, modW2, *modWE;
-	Synthesizer syn1, syn2, *synE;
-	SignedModulator modO1, modO2, *modOE;
+	// Processing graph.
+	WaveEngine engine;
+	
+	// Parameter updates taken from the handoff, flagged in paramUpdateFlags.
+	float paramUpdates[kNumAllParams];
+	unsigned int paramUpdateFlags[WP_PARAM_FLAG_WORDS];
 	
-	// Setter and processing handler state.
-	int editMode;
-	method4fpi procHandler, procRHandler;
+	// Processing handler state.
 	int in0Index, in1Index, out0Index, out1Index;
 	
+#ifdef WP_PROFILE
+	// Written by the processing thread, readable from any thread.
+	Profiler profiler;
+#endif
+	
 public: // public methods
 	// Constructor.
 	WavePlug(audioMasterCallback audioMaster);
@@ -186,74 +192,27 @@ public: // public methods
 	float getAmplitude(int channel, bool postmod = false);
 	float getFrequency(int channel, bool postmod = false);
 	
+#ifdef WP_PROFILE
+	// Dumps the instrumentation data (see Profiler::dump). Not called on the processing thread.
+	bool dumpProfile(const char *path) {return profiler.dump(path);}
+#endif
+	
 private: // private methods
 	void setOperational(bool flag);
 	
+	// Blocking lock on the processing thread, timed in profiling builds.
+	void enterOnProcessingThread();
+	
 	void doThreadSynchronizedDataExchange();
 	
 	bool reinitialize();
 	
-	// Setters.
+	// Parameter updates.
+	void takeParameterUpdates();
 	int doParameterUpdates();
 	
-	bool setBufferSizeMultiplier(int multiplier);
-	
-	void setEditMode(int mode);
-	
-	void aAIWSetter(float value);
-	void aADWSetter(float value);
-	void aAGLSetter(float value);
-	void aSGLSetter(float value);
-	void aFHTSetter(float value);
-	void aFLTSetter(float value);
-	void aFMinSetter(float value);
-	void aFMaxSetter(float value);
-	void aFWSetter(float value);
-	void aWWSetter(float value);
-	void aITSetter(float value);
-	void aWISetter(float value);
-	
-	void mAModSetter(float value);
-	void mAMixSetter(float value);
-	
-	void mFModSetter(float value);
-	void mFMixSetter(float value);
-	
-	void mWModSetter(float value);
-	void mWMixSetter(float value);
-	
-	void sAOffSetter(float value);
-	void sAGainSetter(float value);
-	void sFOffSetter(float value);
-	void sFGainSetter(float value);
-	void sOverSetter(float value);
-	void sWindSetter(float value);
-	
-	void mOModSetter(float value);
-	void mOMixSetter(float value);
-	
 	// Processing handlers.
 	void setProcHandlers();
-	
-	void procDoNothing(float *in0, float *in1, float *out0, float *out1, int sampleFrames) {}
-	
-	void proc1In1Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void proc1In1OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void proc1In2Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void proc1In2OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void proc2In1Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void proc2In1OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void proc2In2Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void proc2In2OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	
-	void procR1In1Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void procR1In1OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void procR1In2Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void procR1In2OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void procR2In1Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void procR2In1OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void procR2In2Out(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
-	void procR2In2OutB(float *in0, float *in1, float *out0, float *out1, int sampleFrames);
 };
 
 #endif
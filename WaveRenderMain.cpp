@@ -0,0 +1,663 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "wpstdinclude.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <vector>
+#include "WaveEngine.hpp"
+#include "WaveEngineBatch.hpp"
+#include "wpfpu.hpp"
+#include "wpprofile.hpp"
+
+// Offline renderer. Runs WAV or raw float files through the processing graph of the plugin
+// and writes the replacing output. Usage is printed by printUsage.
+
+#define WR_CHUNK_FRAMES 4096
+
+enum SampleFormat {kFormatPCM16, kFormatPCM24, kFormatPCM32, kFormatFloat32};
+
+struct AudioFile {
+	std::FILE *file;
+	SampleFormat format;
+	int nChannels, frameBytes;
+	float sampleRate;
+	long nFrames; // Frames left to read, or frames written.
+	long dataStart; // Offset of WAV data chunk (for writing), or -1 for raw.
+};
+
+static void printUsage() {
+	std::fputs(
+		"Usage: LostTechRender [options] input output [input output ...]\n"
+		"\n"
+		"Options:\n"
+		"  -p FILE        Read parameters from FILE. Each line is \"Name value\".\n"
+		"  -s Name=value  Set one parameter.\n"
+		"  -r RATE        Input is raw 32-bit float at RATE Hz instead of WAV.\n"
+		"  -c N           Number of raw input channels (1 or 2, default 1).\n"
+		"  -o N           Number of output channels (1 or 2, default 2).\n"
+		"  -f             Write raw 32-bit float instead of a 32-bit float WAV.\n"
+		"  -b             Band-limited wavetable synthesis. Oversmp is ignored.\n"
+		"  -i MODE        Waveform interpolation used when Interp is on: Linear (default),\n"
+		"                 Hermite, Lagrange or Sinc. -i1 and -i2 set one channel.\n"
+		"  -a             Process every block, even when the input and output are silent.\n"
+		"  -q             Whole-sample cycle lengths in the analyzers, as in older versions.\n"
+		"  -t MODE        Cycle trigger: Crossing (default) or YIN, which cuts cycles to the\n"
+		"                 detected period. -t1 and -t2 set one channel.\n"
+		"  -d FILTER      Decimation filter for Oversmp: Box (default), Low, Medium or High.\n"
+		"  -n N           Process blocks of N frames (1-4096, default 4096), like a host.\n"
+		"  -P FILE        Time each block against its real-time deadline and write the\n"
+		"                 results to FILE. Only in builds with WP_PROFILE.\n"
+		"\n"
+		"Each input is rendered to the output after it by its own instance of the graph,\n"
+		"with the same settings. Several instances are processed together, which is\n"
+		"faster than rendering the files one at a time. The inputs must have the same\n"
+		"sample rate.\n"
+		"\n"
+		"Parameter values are 0-1, as in the plugin. Names are the plugin's parameter\n"
+		"names: BufrSize, or a stereo parameter name followed by 1 or 2 (e.g. AModMix1).\n"
+		"A stereo parameter name without a channel number sets both channels.\n"
+		"Lines starting with '#' in a parameter file are ignored.\n",
+		stderr);
+}
+
+
+// ---<<< Parameters >>>---
+static bool setParameterByName(float *values, const char *name, float value) {
+	if (!std::strcmp(name, "BufrSize")) {
+		values[kBufferSize] = value;
+		return true;
+	}
+	
+	for (int i = 0; i < kNumParams; i++) {
+		const char *paramName = WaveEngine::paramNames[i];
+		size_t length = std::strlen(paramName);
+		
+		if (std::strncmp(name, paramName, length))
+			continue;
+		
+		if (!std::strcmp(name + length, "") || !std::strcmp(name + length, "1"))
+			values[kNumMonoParams + i] = value;
+		if (!std::strcmp(name + length, "") || !std::strcmp(name + length, "2"))
+			values[kNumMonoParams + kNumParams + i] = value;
+		if (!std::strcmp(name + length, "") || !std::strcmp(name + length, "1") ||
+		    !std::strcmp(name + length, "2"))
+			return true;
+	}
+	
+	return false;
+}
+
+static bool parseAssignment(float *values, const char *text) {
+	char name[64];
+	float value;
+	int length = 0;
+	
+	// Name and value are separated by '=' and/or whitespace.
+	if (std::sscanf(text, " %63[^= \t] %n", name, &length) == 1 && text[length] == '=')
+		length++;
+	
+	if (length == 0 || std::sscanf(text + length, "%f", &value) != 1 ||
+	    value < 0.0f || value > 1.0f || !setParameterByName(values, name, value)) {
+		std::fprintf(stderr, "Bad parameter setting: %s\n", text);
+		return false;
+	}
+	
+	return true;
+}
+
+static bool readPreset(float *values, const char *path) {
+	std::FILE *file = std::fopen(path, "r");
+	if (file == NULL) {
+		std::fprintf(stderr, "Can't open parameter file %s\n", path);
+		return false;
+	}
+	
+	char line[256];
+	bool success = true;
+	
+	while (success && std::fgets(line, sizeof line, file)) {
+		char *text = line + std::strspn(line, " \t");
+		
+		if (*text == '#' || *text == '\n' || *text == '\r' || *text == '\0')
+			continue;
+		
+		success = parseAssignment(values, text);
+	}
+	
+	std::fclose(file);
+	return success;
+}
+
+// Returns the InterpolationMode named text (case-sensitive), or -1. None is not
+// accepted, since interpolation is turned off with the Interp parameter.
+static int parseInterpolationMode(const char *text) {
+	for (int i = kInterpLinear; i < kNumInterpModes; i++) {
+		if (!std::strcmp(text, interpolationModeNames[i]))
+			return i;
+	}
+	
+	std::fprintf(stderr, "Unknown interpolation mode: %s\n", text);
+	return -1;
+}
+
+// Returns the TriggerMode named text (case-sensitive), or -1.
+static int parseTriggerMode(const char *text) {
+	for (int i = 0; i < kNumTriggerModes; i++) {
+		if (!std::strcmp(text, triggerModeNames[i]))
+			return i;
+	}
+	
+	std::fprintf(stderr, "Unknown trigger mode: %s\n", text);
+	return -1;
+}
+
+// Returns the DecimationFilter named text (case-sensitive), or -1.
+static int parseDecimationFilter(const char *text) {
+	for (int i = 0; i < kNumDecimFilters; i++) {
+		if (!std::strcmp(text, decimationFilterNames[i]))
+			return i;
+	}
+	
+	std::fprintf(stderr, "Unknown decimation filter: %s\n", text);
+	return -1;
+}
+
+
+// ---<<< Sample files >>>---
+// NOTE: WAV files are little-endian. The bytes are put together explicitly
+// so the renderer works on any host.
+static unsigned long readLE(const unsigned char *bytes, int n) {
+	unsigned long value = 0;
+	for (int i = n-1; i >= 0; i--)
+		value = value << 8 | bytes[i];
+	return value;
+}
+
+static void writeLE(unsigned char *bytes, unsigned long value, int n) {
+	for (int i = 0; i < n; i++, value >>= 8)
+		bytes[i] = (unsigned char) (value & 0xff);
+}
+
+static bool openWavInput(AudioFile &in, const char *path) {
+	unsigned char header[12], chunk[8], fmt[40];
+	bool haveFormat = false;
+	
+	if (!(in.file = std::fopen(path, "rb"))) {
+		std::fprintf(stderr, "Can't open input file %s\n", path);
+		return false;
+	}
+	
+	if (std::fread(header, 1, 12, in.file) != 12 ||
+	    std::memcmp(header, "RIFF", 4) || std::memcmp(header + 8, "WAVE", 4))
+		goto bad_file;
+	
+	while (std::fread(chunk, 1, 8, in.file) == 8) {
+		unsigned long size = readLE(chunk + 4, 4);
+		
+		if (!std::memcmp(chunk, "fmt ", 4)) {
+			if (size < 16 || size > sizeof fmt || std::fread(fmt, 1, size, in.file) != size)
+				goto bad_file;
+			
+			int tag = (int) readLE(fmt, 2), bits = (int) readLE(fmt + 14, 2);
+			if (tag == 0xfffe && size >= 26) // WAVE_FORMAT_EXTENSIBLE. Use subformat.
+				tag = (int) readLE(fmt + 24, 2);
+			
+			in.nChannels = (int) readLE(fmt + 2, 2);
+			in.sampleRate = (float) readLE(fmt + 4, 4);
+			
+			if (tag == 1 && bits == 16)
+				in.format = kFormatPCM16;
+			else if (tag == 1 && bits == 24)
+				in.format = kFormatPCM24;
+			else if (tag == 1 && bits == 32)
+				in.format = kFormatPCM32;
+			else if (tag == 3 && bits == 32)
+				in.format = kFormatFloat32;
+			else {
+				std::fprintf(stderr, "Unsupported sample format in %s\n", path);
+				std::fclose(in.file);
+				return false;
+			}
+			
+			in.frameBytes = in.nChannels * bits/8;
+			haveFormat = true;
+			
+			if (size & 1) // Chunks are padded to even size.
+				std::fseek(in.file, 1, SEEK_CUR);
+		}
+		else if (!std::memcmp(chunk, "data", 4)) {
+			if (!haveFormat || in.nChannels < 1)
+				goto bad_file;
+			
+			in.nFrames = (long) (size / in.frameBytes);
+			in.dataStart = -1;
+			return true;
+		}
+		else if (std::fseek(in.file, (long) (size + (size & 1)), SEEK_CUR))
+			goto bad_file;
+	}
+	
+	bad_file:
+	std::fprintf(stderr, "%s is not a WAV file\n", path);
+	std::fclose(in.file);
+	return false;
+}
+
+static bool openRawInput(AudioFile &in, const char *path, float sampleRate, int nChannels) {
+	if (!(in.file = std::fopen(path, "rb"))) {
+		std::fprintf(stderr, "Can't open input file %s\n", path);
+		return false;
+	}
+	
+	in.format = kFormatFloat32;
+	in.nChannels = nChannels;
+	in.frameBytes = 4 * nChannels;
+	in.sampleRate = sampleRate;
+	in.nFrames = -1; // Until end of file.
+	in.dataStart = -1;
+	return true;
+}
+
+// Reads up to nFrames frames into ch0 and ch1. Mono files fill ch1 with a copy of ch0
+// and only the first two channels of larger files are used. Returns the number of frames read.
+static int readFrames(AudioFile &in, float *ch0, float *ch1, int nFrames) {
+	static unsigned char bytes[WR_CHUNK_FRAMES * 64];
+	
+	if (in.nFrames >= 0)
+		nFrames = (int) std::min((long) nFrames, in.nFrames);
+	nFrames = std::min(nFrames, (int) (sizeof bytes / in.frameBytes));
+	
+	nFrames = (int) std::fread(bytes, in.frameBytes, nFrames, in.file);
+	if (in.nFrames >= 0)
+		in.nFrames -= nFrames;
+	
+	int sampleBytes = in.frameBytes / in.nChannels;
+	
+	for (int i = 0; i < nFrames; i++) {
+		float *dst[2] = {ch0 + i, ch1 + i};
+		
+		for (int c = 0; c < std::min(in.nChannels, 2); c++) {
+			const unsigned char *s = bytes + i*in.frameBytes + c*sampleBytes;
+			unsigned long u = readLE(s, sampleBytes);
+			float v;
+			
+			switch (in.format) {
+				case kFormatPCM16:
+				v = (float) (short) u / 32768.0f;
+				break;
+				
+				case kFormatPCM24: // Flipping the sign bit and subtracting sign extends.
+				v = (float) ((long) (u ^ 0x800000UL) - 0x800000L) / 8388608.0f;
+				break;
+				
+				case kFormatPCM32:
+				v = (float) ((double) (long long) (u ^ 0x80000000UL) - 2147483648.0) / 2147483648.0f;
+				break;
+				
+				default: {
+					unsigned int w = (unsigned int) u;
+					std::memcpy(&v, &w, 4);
+				}
+			}
+			
+			*dst[c] = v;
+		}
+		
+		if (in.nChannels == 1)
+			*dst[1] = *dst[0];
+	}
+	
+	return nFrames;
+}
+
+static bool openOutput(AudioFile &out, const char *path, bool raw, float sampleRate, int nChannels) {
+	if (!(out.file = std::fopen(path, "wb"))) {
+		std::fprintf(stderr, "Can't open output file %s\n", path);
+		return false;
+	}
+	
+	out.format = kFormatFloat32;
+	out.nChannels = nChannels;
+	out.frameBytes = 4 * nChannels;
+	out.sampleRate = sampleRate;
+	out.nFrames = 0;
+	out.dataStart = -1;
+	
+	if (!raw) { // Sizes are filled in by closeOutput.
+		unsigned char header[44];
+		
+		std::memcpy(header, "RIFF\0\0\0\0WAVEfmt ", 16);
+		writeLE(header + 16, 16, 4);
+		writeLE(header + 20, 3, 2); // IEEE float.
+		writeLE(header + 22, nChannels, 2);
+		writeLE(header + 24, (unsigned long) sampleRate, 4);
+		writeLE(header + 28, (unsigned long) sampleRate * out.frameBytes, 4);
+		writeLE(header + 32, out.frameBytes, 2);
+		writeLE(header + 34, 32, 2);
+		std::memcpy(header + 36, "data\0\0\0\0", 8);
+		
+		out.dataStart = 44;
+		if (std::fwrite(header, 1, 44, out.file) != 44)
+			return false;
+	}
+	
+	return true;
+}
+
+static bool writeFrames(AudioFile &out, const float *ch0, const float *ch1, int nFrames) {
+	static unsigned char bytes[WR_CHUNK_FRAMES * 8];
+	const float *src[2] = {ch0, ch1};
+	
+	for (int i = 0; i < nFrames; i++) {
+		for (int c = 0; c < out.nChannels; c++) {
+			unsigned int w;
+			std::memcpy(&w, src[c] + i, 4);
+			writeLE(bytes + i*out.frameBytes + 4*c, w, 4);
+		}
+	}
+	
+	out.nFrames += nFrames;
+	return std::fwrite(bytes, out.frameBytes, nFrames, out.file) == (size_t) nFrames;
+}
+
+static bool closeOutput(AudioFile &out) {
+	bool success = true;
+	
+	if (out.dataStart >= 0) {
+		unsigned char size[4];
+		unsigned long dataBytes = (unsigned long) out.nFrames * out.frameBytes;
+		
+		writeLE(size, dataBytes + 36, 4);
+		success = !std::fseek(out.file, 4, SEEK_SET) && std::fwrite(size, 1, 4, out.file) == 4;
+		writeLE(size, dataBytes, 4);
+		success = success && !std::fseek(out.file, 40, SEEK_SET) &&
+		          std::fwrite(size, 1, 4, out.file) == 4;
+	}
+	
+	return (std::fclose(out.file) == 0) & success;
+}
+
+
+// ---<<< Main >>>---
+int main(int argc, char **argv) {
+	float values[kNumAllParams];
+	float rawRate = 0.0f;
+	int rawChannels = 1, nOutputs = 2;
+	bool rawOut = false, bandLimited = false, wholeCycles = false, alwaysProcess = false;
+	InterpolationMode interpModes[2] = {kInterpLinear, kInterpLinear};
+	TriggerMode triggerModes[2] = {kTriggerCrossing, kTriggerCrossing};
+	DecimationFilter decimationFilter = kDecimBox;
+	int blockFrames = WR_CHUNK_FRAMES;
+	const char *profilePath = NULL;
+	std::vector<const char *> paths; // Input and output of each instance.
+	
+	for (int i = 0; i < kNumAllParams; i++)
+		values[i] = WaveEngine::getInitParamValue(i);
+	
+	// Parse arguments.
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		bool hasValue = i+1 < argc;
+		
+		if (!std::strcmp(arg, "-p") && hasValue) {
+			if (!readPreset(values, argv[++i]))
+				return 1;
+		}
+		else if (!std::strcmp(arg, "-s") && hasValue) {
+			if (!parseAssignment(values, argv[++i]))
+				return 1;
+		}
+		else if (!std::strcmp(arg, "-r") && hasValue)
+			rawRate = (float) std::atof(argv[++i]);
+		else if (!std::strcmp(arg, "-c") && hasValue)
+			rawChannels = std::atoi(argv[++i]);
+		else if (!std::strcmp(arg, "-o") && hasValue)
+			nOutputs = std::atoi(argv[++i]);
+		else if (!std::strcmp(arg, "-f"))
+			rawOut = true;
+		else if (!std::strcmp(arg, "-b"))
+			bandLimited = true;
+		else if (!std::strcmp(arg, "-q"))
+			wholeCycles = true;
+		else if (!std::strcmp(arg, "-a"))
+			alwaysProcess = true;
+		else if ((!std::strcmp(arg, "-i") || !std::strcmp(arg, "-i1") || !std::strcmp(arg, "-i2")) &&
+		         hasValue) {
+			int mode = parseInterpolationMode(argv[++i]);
+			if (mode < 0)
+				return 1;
+			
+			if (arg[2] != '2')
+				interpModes[0] = (InterpolationMode) mode;
+			if (arg[2] != '1')
+				interpModes[1] = (InterpolationMode) mode;
+		}
+		else if ((!std::strcmp(arg, "-t") || !std::strcmp(arg, "-t1") || !std::strcmp(arg, "-t2")) &&
+		         hasValue) {
+			int mode = parseTriggerMode(argv[++i]);
+			if (mode < 0)
+				return 1;
+			
+			if (arg[2] != '2')
+				triggerModes[0] = (TriggerMode) mode;
+			if (arg[2] != '1')
+				triggerModes[1] = (TriggerMode) mode;
+		}
+		else if (!std::strcmp(arg, "-d") && hasValue) {
+			int filter = parseDecimationFilter(argv[++i]);
+			if (filter < 0)
+				return 1;
+			
+			decimationFilter = (DecimationFilter) filter;
+		}
+		else if (!std::strcmp(arg, "-n") && hasValue)
+			blockFrames = std::atoi(argv[++i]);
+		else if (!std::strcmp(arg, "-P") && hasValue)
+			profilePath = argv[++i];
+		else if (arg[0] == '-' && arg[1] != '\0') {
+			printUsage();
+			return 1;
+		}
+		else
+			paths.push_back(arg);
+	}
+	
+#ifndef WP_PROFILE
+	if (profilePath != NULL) {
+		std::fputs("-P needs a build with WP_PROFILE (the LOSTTECH_PROFILE CMake option)\n", stderr);
+		return 1;
+	}
+#endif
+	
+	if (paths.empty() || paths.size() % 2 != 0 || rawRate < 0.0f || blockFrames < 1 || blockFrames > WR_CHUNK_FRAMES ||
+	    rawChannels < 1 || rawChannels > 2 || nOutputs < 1 || nOutputs > 2) {
+		printUsage();
+		return 1;
+	}
+	
+	// Open files.
+	int nInstances = (int) paths.size() / 2, nOpen = 0;
+	std::vector<AudioFile> ins(nInstances), outs(nInstances);
+	bool success = true;
+	
+	for (; nOpen < nInstances; nOpen++) {
+		AudioFile &in = ins[nOpen];
+		const char *inPath = paths[2*nOpen], *outPath = paths[2*nOpen + 1];
+		
+		if (!((rawRate > 0.0f) ? openRawInput(in, inPath, rawRate, rawChannels) : openWavInput(in, inPath))) {
+			success = false;
+			break;
+		}
+		
+		if (in.sampleRate != ins[0].sampleRate) {
+			std::fprintf(stderr, "%s doesn't have the sample rate of %s\n", inPath, paths[0]);
+			std::fclose(in.file);
+			success = false;
+			break;
+		}
+		
+		if (!openOutput(outs[nOpen], outPath, rawOut, in.sampleRate, nOutputs)) {
+			std::fclose(in.file);
+			success = false;
+			break;
+		}
+	}
+	
+	// Set up the processing graphs like the plugin does.
+	std::vector<WaveEngine *> engines(nInstances, (WaveEngine *) NULL);
+	WaveEngineBatch batch;
+	
+	setGlobalSampleRate(ins[0].sampleRate);
+	
+	for (int k = 0; success && k < nInstances; k++) {
+		WaveEngine *engine = NULL;
+		
+		try {
+			engine = engines[k] = new WaveEngine();
+		}
+		catch (std::bad_alloc e) {
+			engine = NULL;
+		}
+		catch (std::runtime_error e) {
+			engine = NULL;
+		}
+		
+		if (engine == NULL || !engine->initialize()) {
+			std::fputs("Processing graph initialization failed\n", stderr);
+			success = false;
+			break;
+		}
+		
+		for (int i = 0; i < kNumAllParams; i++)
+			engine->setParameter(i, values[i]);
+		
+		engine->setInterpolationMode(0, interpModes[0]);
+		engine->setInterpolationMode(1, interpModes[1]);
+		engine->setDecimationFilter(decimationFilter);
+		engine->setFractionalCycles(!wholeCycles);
+		engine->setSkipSilence(!alwaysProcess);
+		engine->setRampTime(WP_PARAM_RAMP_TIME);
+		engine->setProcessMode(ins[k].nChannels > 1, nOutputs > 1, false);
+		
+		if (!engine->isOperational() || (bandLimited && !engine->setBandLimited(true)) ||
+		    !engine->setTriggerMode(0, triggerModes[0]) || !engine->setTriggerMode(1, triggerModes[1])) {
+			std::fputs("Sample buffer allocation failed\n", stderr);
+			success = false;
+		}
+	}
+	
+	if (success && nInstances > 1 && !batch.setEngines(&engines[0], nInstances)) {
+		std::fputs("Sample buffer allocation failed\n", stderr);
+		success = false;
+	}
+	
+	if (!success) {
+		for (int k = 0; k < nOpen; k++) {
+			std::fclose(ins[k].file);
+			std::fclose(outs[k].file);
+		}
+		for (int k = 0; k < nInstances; k++)
+			delete engines[k];
+		return 1;
+	}
+	
+	// Render. Inputs that have ended are followed by silence until the last one ends, but
+	// only the frames of each input are written.
+	std::vector<float> buffers(4 * nInstances * WR_CHUNK_FRAMES);
+	std::vector<float *> in0(nInstances), in1(nInstances), out0(nInstances), out1(nInstances);
+	std::vector<int> nFrames(nInstances);
+	int blockEnd;
+	
+	for (int k = 0; k < nInstances; k++) {
+		in0[k] = &buffers[4*k * WR_CHUNK_FRAMES];
+		in1[k] = in0[k] + WR_CHUNK_FRAMES;
+		out0[k] = in1[k] + WR_CHUNK_FRAMES;
+		out1[k] = out0[k] + WR_CHUNK_FRAMES;
+	}
+	
+#ifdef WP_PROFILE
+	Profiler *profiler = new Profiler();
+#endif
+	
+	// Like the plugin, but set once for the whole render instead of once per block.
+	DenormalGuard denormalGuard;
+	
+	do {
+		blockEnd = 0;
+		
+		for (int k = 0; k < nInstances; k++) {
+			nFrames[k] = readFrames(ins[k], in0[k], in1[k], blockFrames);
+			std::fill(in0[k] + nFrames[k], in0[k] + blockFrames, 0.0f);
+			std::fill(in1[k] + nFrames[k], in1[k] + blockFrames, 0.0f);
+			blockEnd = std::max(blockEnd, nFrames[k]);
+		}
+		
+		if (blockEnd == 0)
+			break;
+		
+		{
+			WP_PROFILE_BLOCK(profiler, blockEnd, ins[0].sampleRate);
+			
+			if (nInstances > 1)
+				batch.processReplacing(&in0[0], &in1[0], &out0[0], (nOutputs > 1) ? &out1[0] : NULL, blockEnd);
+			else
+				engines[0]->processReplacing(in0[0], in1[0], out0[0], out1[0], blockEnd);
+		}
+		
+		for (int k = 0; success && k < nInstances; k++) {
+			if (!writeFrames(outs[k], out0[k], out1[k], nFrames[k])) {
+				std::fprintf(stderr, "Can't write output file %s\n", paths[2*k + 1]);
+				success = false;
+			}
+		}
+	} while (success);
+	
+	for (int k = 0; k < nInstances; k++) {
+		std::fclose(ins[k].file);
+		delete engines[k];
+		
+		if (!closeOutput(outs[k]) && success) {
+			std::fprintf(stderr, "Can't write output file %s\n", paths[2*k + 1]);
+			success = false;
+		}
+	}
+	
+	if (!success)
+		return 1;
+	
+#ifdef WP_PROFILE
+	// Without -P the profiler still runs, but nothing is written.
+	bool dumped = profilePath == NULL || profiler->dump(profilePath);
+	delete profiler;
+	
+	if (!dumped) {
+		std::fprintf(stderr, "Can't write profile %s\n", profilePath);
+		return 1;
+	}
+#endif
+	
+	return 0;
+}
@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Wavetable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include "wpfft.hpp"
+
+#define WP_WT_TABLES_SIZE \
+	((2 << WP_WT_MAX_LOG2_SIZE) - (1 << WP_WT_MIN_LOG2_SIZE) + WP_WT_NUM_LEVELS)
+
+void Wavetable::initialize(BufferManager *bMan) {
+	bufferManager = bMan;
+	tables = spectrumRe = spectrumIm = pongSpectrumRe = pongSpectrumIm = workRe = workIm = NULL;
+	spectrumLog2Size = 0;
+	source = NULL;
+	sourceVersion = 0;
+	sourcePong = false;
+}
+
+bool Wavetable::allocate() {
+	if (tables != NULL)
+		return true;
+	
+	// Half a spectrum of the largest table.
+	int spectrumSize = (1 << (WP_WT_MAX_LOG2_SIZE - 1)) + 1;
+	
+	if (!(tables = bufferManager->newFloatBuffer(2 * WP_WT_TABLES_SIZE)))
+		goto alloc_failed;
+	if (!(spectrumRe = bufferManager->newFloatBuffer(spectrumSize)))
+		goto alloc_failed;
+	if (!(spectrumIm = bufferManager->newFloatBuffer(spectrumSize)))
+		goto alloc_failed;
+	if (!(pongSpectrumRe = bufferManager->newFloatBuffer(spectrumSize)))
+		goto alloc_failed;
+	if (!(pongSpectrumIm = bufferManager->newFloatBuffer(spectrumSize)))
+		goto alloc_failed;
+	if (!(workRe = bufferManager->newFloatBuffer(spectrumSize)))
+		goto alloc_failed;
+	if (!(workIm = bufferManager->newFloatBuffer(spectrumSize)))
+		goto alloc_failed;
+	
+	for (int k = 0, offset = 0; k < WP_WT_NUM_LEVELS; k++) {
+		levelTables[k] = tables + offset;
+		pongLevelTables[k] = tables + WP_WT_TABLES_SIZE + offset;
+		offset += (1 << (WP_WT_MAX_LOG2_SIZE - k)) + 1;
+	}
+	
+	source = NULL;
+	return true;
+	
+	alloc_failed:
+	release();
+	return false;
+}
+
+void Wavetable::release() {
+	bufferManager->deleteFloatBuffer(tables);
+	bufferManager->deleteFloatBuffer(spectrumRe);
+	bufferManager->deleteFloatBuffer(spectrumIm);
+	bufferManager->deleteFloatBuffer(pongSpectrumRe);
+	bufferManager->deleteFloatBuffer(pongSpectrumIm);
+	bufferManager->deleteFloatBuffer(workRe);
+	bufferManager->deleteFloatBuffer(workIm);
+	tables = spectrumRe = spectrumIm = pongSpectrumRe = pongSpectrumIm = workRe = workIm = NULL;
+}
+
+const float *Wavetable::getTable(
+	FunctionModulator *wave, int nSamples, int &log2Size, const float *&pongTable)
+{
+	// Largest power of 2 <= 4*nSamples.
+	log2Size = WP_WT_MIN_LOG2_SIZE;
+	while (log2Size < WP_WT_MAX_LOG2_SIZE & (2 << log2Size) <= 4*nSamples)
+		log2Size++;
+	
+	int level = WP_WT_MAX_LOG2_SIZE - log2Size;
+	unsigned int version = wave->getVersion();
+	
+	// The version changes with the modulation type.
+	if (wave != source | version != sourceVersion) {
+		source = wave;
+		sourceVersion = version;
+		sourcePong = wave->getModulation() == kModTypeFPong;
+		spectrumLog2Size = 0;
+		std::fill(levelBuilt, levelBuilt + WP_WT_NUM_LEVELS, false);
+	}
+	
+	if (!levelBuilt[level]) {
+		// Smaller tables are cut from the spectrum of a larger one.
+		if (spectrumLog2Size < log2Size)
+			buildSpectrum(log2Size);
+		
+		buildLevel(level);
+	}
+	
+	pongTable = (sourcePong) ? pongLevelTables[level] : NULL;
+	return levelTables[level];
+}
+
+void Wavetable::buildSpectrum(int log2Size) {
+	int level = WP_WT_MAX_LOG2_SIZE - log2Size;
+	
+	// The snapshots are rendered into the tables about to be built from them.
+	source->renderSnapshot(levelTables[level], 1 << log2Size, 0.0f);
+	realFft(levelTables[level], spectrumRe, spectrumIm, log2Size);
+	
+	if (sourcePong) {
+		source->renderSnapshot(pongLevelTables[level], 1 << log2Size, 1.0f);
+		realFft(pongLevelTables[level], pongSpectrumRe, pongSpectrumIm, log2Size);
+	}
+	
+	spectrumLog2Size = log2Size;
+}
+
+void Wavetable::buildLevel(int level) {
+	int log2Size = WP_WT_MAX_LOG2_SIZE - level;
+	
+	bandLimit(spectrumRe, spectrumIm, levelTables[level], log2Size);
+	if (sourcePong)
+		bandLimit(pongSpectrumRe, pongSpectrumIm, pongLevelTables[level], log2Size);
+	
+	levelBuilt[level] = true;
+}
+
+// Writes the table with 2^log2Size points holding DC and the harmonics up to 2^log2Size/8 of
+// the spectrum in re and im.
+void Wavetable::bandLimit(const float *re, const float *im, float *table, int log2Size) {
+	int size = 1 << log2Size, nHarmonics = size/8;
+	float scale = 1.0f / (1 << spectrumLog2Size);
+	
+	for (int h = 0; h <= nHarmonics; h++) {
+		workRe[h] = scale*re[h];
+		workIm[h] = scale*im[h];
+	}
+	std::fill(workRe + nHarmonics + 1, workRe + size/2 + 1, 0.0f);
+	std::fill(workIm + nHarmonics + 1, workIm + size/2 + 1, 0.0f);
+	workIm[0] = 0.0f;
+	
+	inverseRealFft(workRe, workIm, table, log2Size);
+	table[size] = table[0];
+}
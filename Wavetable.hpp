@@ -0,0 +1,81 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_WAVETABLE_HPP
+#define WP_WAVETABLE_HPP
+
+#include "wpfunc.hpp"
+#include "BufferManager.hpp"
+#include "wpmodulators.hpp"
+
+// Smallest and largest table size as powers of 2.
+#define WP_WT_MIN_LOG2_SIZE 3
+#define WP_WT_MAX_LOG2_SIZE 12
+#define WP_WT_NUM_LEVELS (WP_WT_MAX_LOG2_SIZE - WP_WT_MIN_LOG2_SIZE + 1)
+
+// Band-limited copies of the cycle output by a FunctionModulator, one per octave.
+// A table with 2^n points keeps the harmonics up to 2^n/8. It is used for cycles of
+// 2^(n-2) to 2^(n-1) - 1 samples, which can hold all of those harmonics without aliasing.
+// Tables 4 times wider than the kept band keep linear interpolation accurate.
+// Only the table asked for is built, from a spectrum that is kept until the modulator's
+// inputs or settings change, which on live input is about once a cycle. The cycle is
+// rendered with as many points as the table, as a snapshot, so building tables doesn't move
+// the modulator along. Harmonics above 7/8 of the table size fold back into the kept band,
+// but the analyzer cycles have little there.
+// In Pong mode each level has a second table, with the LFO at 1 instead of 0.
+class Wavetable {
+private:
+	BufferManager *bufferManager;
+	
+	// Level k holds the table with 2^(WP_WT_MAX_LOG2_SIZE - k) + 1 points, and its Pong table.
+	float *tables, *levelTables[WP_WT_NUM_LEVELS], *pongLevelTables[WP_WT_NUM_LEVELS];
+	bool levelBuilt[WP_WT_NUM_LEVELS];
+	
+	// First half of the spectrum of the source cycle rendered with 2^spectrumLog2Size points,
+	// and of the cycle with the LFO at 1 in Pong mode. FFT work space.
+	float *spectrumRe, *spectrumIm, *pongSpectrumRe, *pongSpectrumIm, *workRe, *workIm;
+	int spectrumLog2Size;
+	
+	FunctionModulator *source;
+	unsigned int sourceVersion;
+	bool sourcePong;
+	
+public:
+	void initialize(BufferManager *bMan);
+	
+	// Allocates and frees the tables. The wavetable can only be used while allocated.
+	bool allocate();
+	void release();
+	bool isAllocated() {return tables != NULL;}
+	
+	// Returns the table for playing the cycle output by wave with nSamples samples.
+	// Sets log2Size to the table size. The table has one extra point repeating the first.
+	// In Pong mode the table has the LFO at 0 and pongTable is set to the table with the LFO
+	// at 1. Pong is linear in the LFO, so the two can be blended. Otherwise it's set to NULL.
+	const float *getTable(
+		FunctionModulator *wave, int nSamples, int &log2Size, const float *&pongTable);
+	
+private:
+	void buildSpectrum(int log2Size);
+	void buildLevel(int level);
+	void bandLimit(const float *re, const float *im, float *table, int log2Size);
+};
+
+#endif
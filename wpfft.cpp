@@ -0,0 +1,185 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "wpfft.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Twiddle factors exp(-i*pi*k/half) for each butterfly stage, at index half + k, so each
+// stage reads them in order, and the bit-reversed indices of the largest transform.
+struct FFTTables {
+	float twiddleRe[1 << WP_FFT_MAX_LOG2_SIZE], twiddleIm[1 << WP_FFT_MAX_LOG2_SIZE];
+	unsigned short bitReversed[1 << WP_FFT_MAX_LOG2_SIZE];
+};
+
+static FFTTables *computeFFTTables() {
+	static FFTTables tables;
+	
+	for (int half = 1; half < (1 << WP_FFT_MAX_LOG2_SIZE); half <<= 1) {
+		for (int k = 0; k < half; k++) {
+			double angle = -3.14159265358979323846 * k / half;
+			tables.twiddleRe[half + k] = (float) std::cos(angle);
+			tables.twiddleIm[half + k] = (float) std::sin(angle);
+		}
+	}
+	
+	for (int i = 0; i < (1 << WP_FFT_MAX_LOG2_SIZE); i++) {
+		int j = 0;
+		for (int bit = 0; bit < WP_FFT_MAX_LOG2_SIZE; bit++)
+			j |= ((i >> bit) & 1) << (WP_FFT_MAX_LOG2_SIZE - 1 - bit);
+		tables.bitReversed[i] = (unsigned short) j;
+	}
+	
+	return &tables;
+}
+
+static const FFTTables &getFFTTables() {
+	static const FFTTables *tables = computeFFTTables();
+	return *tables;
+}
+
+void fft(float *re, float *im, int log2Size, bool inverse) {
+	const FFTTables &tables = getFFTTables();
+	int size = 1 << log2Size, shift = WP_FFT_MAX_LOG2_SIZE - log2Size;
+	float sign = (inverse) ? -1.0f : 1.0f;
+	
+	// Bit-reversal permutation.
+	for (int i = 1; i < size; i++) {
+		int j = tables.bitReversed[i] >> shift;
+		
+		if (i < j) {
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+	
+	if (size == 2) {
+		float xRe = re[1], xIm = im[1];
+		
+		re[1] = re[0] - xRe;
+		im[1] = im[0] - xIm;
+		re[0] += xRe;
+		im[0] += xIm;
+	}
+	
+	// The first two stages together. Their twiddle factors are 1 and -i (i for the inverse).
+	for (int i = 0; i + 3 < size; i += 4) {
+		float aRe = re[i] + re[i + 1], aIm = im[i] + im[i + 1],
+		      bRe = re[i] - re[i + 1], bIm = im[i] - im[i + 1],
+		      cRe = re[i + 2] + re[i + 3], cIm = im[i + 2] + im[i + 3],
+		      dRe = sign*(im[i + 2] - im[i + 3]), dIm = sign*(re[i + 3] - re[i + 2]);
+		
+		re[i] = aRe + cRe;
+		im[i] = aIm + cIm;
+		re[i + 1] = bRe + dRe;
+		im[i + 1] = bIm + dIm;
+		re[i + 2] = aRe - cRe;
+		im[i + 2] = aIm - cIm;
+		re[i + 3] = bRe - dRe;
+		im[i + 3] = bIm - dIm;
+	}
+	
+	// Butterflies. The inner loop runs over consecutive values, so it vectorizes.
+	for (int half = 4; half < size; half <<= 1) {
+		const float *wRe = tables.twiddleRe + half, *wIm = tables.twiddleIm + half;
+		
+		for (int start = 0; start < size; start += 2*half) {
+			float *re0 = re + start, *im0 = im + start, *re1 = re0 + half, *im1 = im0 + half;
+			
+			for (int k = 0; k < half; k++) {
+				float tRe = wRe[k], tIm = sign*wIm[k];
+				float xRe = tRe*re1[k] - tIm*im1[k], xIm = tRe*im1[k] + tIm*re1[k];
+				
+				re1[k] = re0[k] - xRe;
+				im1[k] = im0[k] - xIm;
+				re0[k] += xRe;
+				im0[k] += xIm;
+			}
+		}
+	}
+}
+
+// The even values are the real part and the odd values the imaginary part of the half size
+// transform. The spectra E and O of the two halves are separated from it as
+// E[k] = (Z[k] + Z*[n-k])/2 and O[k] = (Z[k] - Z*[n-k])/2i, where n is the half size, and
+// X[k] = E[k] + W^k O[k]. X[n-k] = (E[k] - W^k O[k])*, so k and n-k are done together.
+void realFft(const float *in, float *re, float *im, int log2Size) {
+	const FFTTables &tables = getFFTTables();
+	int half = 1 << (log2Size - 1);
+	const float *wRe = tables.twiddleRe + half, *wIm = tables.twiddleIm + half;
+	
+	for (int k = 0; k < half; k++) {
+		re[k] = in[2*k];
+		im[k] = in[2*k + 1];
+	}
+	
+	fft(re, im, log2Size - 1);
+	
+	re[half] = re[0] - im[0];
+	re[0] += im[0];
+	im[0] = im[half] = 0.0f;
+	
+	for (int k = 1; 2*k <= half; k++) {
+		int j = half - k;
+		float eRe = 0.5f*(re[k] + re[j]), eIm = 0.5f*(im[k] - im[j]),
+		      oRe = 0.5f*(im[k] + im[j]), oIm = 0.5f*(re[j] - re[k]),
+		      tRe = wRe[k]*oRe - wIm[k]*oIm, tIm = wRe[k]*oIm + wIm[k]*oRe;
+		
+		re[j] = eRe - tRe;
+		im[j] = tIm - eIm;
+		re[k] = eRe + tRe;
+		im[k] = eIm + tIm;
+	}
+}
+
+// Runs realFft backwards. The half size transform of the even and odd values is
+// Z[k] = E[k] + i O[k], with E[k] = X[k] + X*[n-k] and O[k] = (X[k] - X*[n-k]) W^-k
+// (twice the spectra, so the result is scaled by the full size like fft).
+// E[n-k] = E*[k] and O[n-k] = O*[k].
+void inverseRealFft(float *re, float *im, float *out, int log2Size) {
+	const FFTTables &tables = getFFTTables();
+	int half = 1 << (log2Size - 1);
+	const float *wRe = tables.twiddleRe + half, *wIm = tables.twiddleIm + half;
+	
+	float dc = re[0], nyquist = re[half];
+	re[0] = dc + nyquist;
+	im[0] = dc - nyquist;
+	
+	// W^-k is the conjugate of the table entry.
+	for (int k = 1; 2*k <= half; k++) {
+		int j = half - k;
+		float eRe = re[k] + re[j], eIm = im[k] - im[j],
+		      dRe = re[k] - re[j], dIm = im[k] + im[j],
+		      oRe = wRe[k]*dRe + wIm[k]*dIm, oIm = wRe[k]*dIm - wIm[k]*dRe;
+		
+		re[j] = eRe + oIm;
+		im[j] = oRe - eIm;
+		re[k] = eRe - oIm;
+		im[k] = eIm + oRe;
+	}
+	
+	fft(re, im, log2Size - 1, true);
+	
+	for (int k = 0; k < half; k++) {
+		out[2*k] = re[k];
+		out[2*k + 1] = im[k];
+	}
+}
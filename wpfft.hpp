@@ -0,0 +1,41 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_WPFFT_HPP
+#define WP_WPFFT_HPP
+
+// Largest transform size as a power of 2.
+#define WP_FFT_MAX_LOG2_SIZE 12
+
+// In-place radix-2 FFT of the 2^log2Size complex values in re and im, with log2Size at most
+// WP_FFT_MAX_LOG2_SIZE. The forward transform uses exp(-i...), the inverse exp(+i...).
+// Neither is scaled.
+void fft(float *re, float *im, int log2Size, bool inverse = false);
+
+// Forward FFT of the 2^log2Size real values in in, computed with a complex FFT of half the
+// size. Writes the first 2^(log2Size-1) + 1 values of the spectrum to re and im. The rest
+// are their complex conjugates. log2Size must be 2 to WP_FFT_MAX_LOG2_SIZE.
+void realFft(const float *in, float *re, float *im, int log2Size);
+
+// Inverse of realFft. Writes the 2^log2Size real values whose spectrum starts with re and im
+// to out, and overwrites re and im. Not scaled, like fft.
+void inverseRealFft(float *re, float *im, float *out, int log2Size);
+
+#endif
@@ -0,0 +1,90 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_WPFPU_HPP
+#define WP_WPFPU_HPP
+
+// SSE control and status register, which is where float math runs on x86-64 and in 32-bit
+// builds that use SSE.
+#if defined(__x86_64__) || defined(_M_X64) || \
+    (defined(__i386__) && defined(__SSE__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define WP_HAVE_MXCSR
+#include <xmmintrin.h>
+#endif
+
+#define WP_MXCSR_FTZ 0x8000u // Flush-to-zero: denormal results become 0.
+#define WP_MXCSR_DAZ 0x0040u // Denormals-are-zero: denormal operands are read as 0.
+
+#ifdef WP_HAVE_MXCSR
+// FTZ, plus DAZ if the CPU has it. Some early SSE CPUs don't, and setting the bit
+// anyway faults. FXSAVE stores the mask of writable MXCSR bits, or 0 for the default
+// mask, which doesn't have DAZ.
+inline unsigned int detectDenormalModeBits() {
+#if defined(__x86_64__) || defined(_M_X64)
+	return WP_MXCSR_FTZ | WP_MXCSR_DAZ; // Every x86-64 CPU has DAZ.
+#else
+	alignas(16) unsigned char area[512] = {0};
+#ifdef _MSC_VER
+	_fxsave(area);
+#else
+	__asm__ __volatile__ ("fxsave %0" : "=m" (area));
+#endif
+	unsigned int mask = area[28] | area[29] << 8 | area[30] << 16 | (unsigned int) area[31] << 24;
+	return WP_MXCSR_FTZ | (mask & WP_MXCSR_DAZ);
+#endif
+}
+#endif
+
+// Turns on flush-to-zero and denormals-are-zero for the current thread while the guard
+// exists and restores the previous modes when it goes out of scope. Decaying tails and
+// silent inputs then can't drop into slow denormal arithmetic. Without SSE math (32-bit
+// x87 builds) it does nothing, and the components' own lower bounds are all that helps.
+class DenormalGuard {
+private:
+#ifdef WP_HAVE_MXCSR
+	unsigned int savedCSR;
+	bool changed;
+#endif
+	
+	DenormalGuard(const DenormalGuard &);
+	DenormalGuard &operator=(const DenormalGuard &);
+	
+public:
+#ifdef WP_HAVE_MXCSR
+	DenormalGuard() {
+		static const unsigned int modeBits = detectDenormalModeBits();
+		
+		// Hosts often set the modes already, and writing MXCSR stalls the pipeline.
+		savedCSR = _mm_getcsr();
+		changed = (savedCSR & modeBits) != modeBits;
+		if (changed)
+			_mm_setcsr(savedCSR | modeBits);
+	}
+	
+	~DenormalGuard() {
+		if (changed)
+			_mm_setcsr(savedCSR);
+	}
+#else
+	DenormalGuard() {}
+#endif
+};
+
+#endif
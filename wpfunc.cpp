@@ -27,6 +27,67 @@ float globalMaxFrequency = sampleRateToMaxFreq(WP_STD_SAMPLE_RATE);
 
 float globalMinPeriodLength = 1.0f / globalMaxFrequency;
 
+const char *const interpolationModeNames[kNumInterpModes] = {
+	"None", "Linear", "Hermite", "Lagrange", "Sinc"
+};
+
+// Interpolation kernel tables. Built the first time a kernel is asked for.
+struct InterpolationKernels {
+	float hermite[(WP_INTERP_PHASES + 1) * 4];
+	float lagrange[(WP_INTERP_PHASES + 1) * 4];
+	float sinc[(WP_INTERP_PHASES + 1) * 8];
+	
+	InterpolationKernels() {
+		const double pi = 3.14159265358979323846;
+		
+		for (int p = 0; p <= WP_INTERP_PHASES; p++) {
+			double t = (double) p / WP_INTERP_PHASES, t2 = t*t, t3 = t2*t;
+			float *h = hermite + 4*p, *l = lagrange + 4*p, *s = sinc + 8*p;
+			
+			// Weights of the samples at offsets -1, 0, 1 and 2.
+			h[0] = (float) (-0.5*t3 + t2 - 0.5*t);
+			h[1] = (float) (1.5*t3 - 2.5*t2 + 1.0);
+			h[2] = (float) (-1.5*t3 + 2.0*t2 + 0.5*t);
+			h[3] = (float) (0.5*t3 - 0.5*t2);
+			
+			l[0] = (float) (-t*(t - 1.0)*(t - 2.0)/6.0);
+			l[1] = (float) ((t + 1.0)*(t - 1.0)*(t - 2.0)/2.0);
+			l[2] = (float) (-(t + 1.0)*t*(t - 2.0)/2.0);
+			l[3] = (float) ((t + 1.0)*t*(t - 1.0)/6.0);
+			
+			// Weights of the samples at offsets -3 to 4, normalized to unity gain at DC.
+			double w[8], sum = 0.0;
+			for (int k = 0; k < 8; k++) {
+				double d = t - (k - 3);
+				double sincD = (std::abs(d) < 1.0e-9) ? 1.0 : std::sin(pi*d)/(pi*d);
+				w[k] = sincD * (0.42 + 0.5*std::cos(pi*d/4.0) + 0.08*std::cos(2.0*pi*d/4.0));
+				sum += w[k];
+			}
+			for (int k = 0; k < 8; k++)
+				s[k] = (float) (w[k] / sum);
+		}
+	}
+};
+
+const float *getInterpolationKernel(InterpolationMode mode, int &taps) {
+	static const InterpolationKernels kernels;
+	
+	switch (mode) {
+		case kInterpHermite:
+			taps = 4;
+			return kernels.hermite;
+		case kInterpLagrange:
+			taps = 4;
+			return kernels.lagrange;
+		case kInterpSinc:
+			taps = 8;
+			return kernels.sinc;
+		default:
+			taps = 0;
+			return NULL;
+	}
+}
+
 // f must point to a buffer containing fSizePlus1 samples.
 // The last sample in the buffer (at offset (fSizePlus1 - 1))
 // must be the first sample of the next waveform.
@@ -68,6 +68,68 @@ WP_EXT_INLINE float fade(float x) {
 	return x / std::sqrt(x2*x2 - x2 + 1.0f);
 }
 
+enum RampShape {kRampLinear, kRampExponential};
+
+// Parameter value that moves to a new target over a fixed time instead of jumping.
+// Exponential ramps fall back to linear ones unless both ends are positive.
+class ParameterRamp {
+private:
+	RampShape shape;
+	bool multiplicative;
+	float value, target, step, time;
+	int nLeft;
+	
+public:
+	ParameterRamp(RampShape rs = kRampLinear, float v = 0.0f)
+		: shape(rs), multiplicative(false), value(v), target(v), step(0.0f), time(0.0f), nLeft(0) {}
+	
+	float getValue() {return value;}
+	float getTarget() {return target;}
+	
+	// Change per sample. Only meaningful for linear ramps.
+	float getStep() {return step;}
+	
+	bool isRamping() {return nLeft > 0;}
+	int getSamplesLeft() {return nLeft;}
+	
+	// Ramp time in seconds. 0 makes new targets take effect at once.
+	float getTime() {return time;}
+	void setTime(float seconds) {time = seconds;}
+	
+	void setTarget(float v) {
+		target = v;
+		nLeft = (int) (time * globalSampleRate);
+		
+		if (nLeft <= 0 | value == target) {
+			finish();
+			return;
+		}
+		
+		multiplicative = shape == kRampExponential & value > 0.0f & target > 0.0f;
+		step = (multiplicative)
+		       ? std::pow(target / value, 1.0f / nLeft)
+		       : (target - value) / nLeft;
+	}
+	
+	void finish() {
+		value = target;
+		step = 0.0f;
+		nLeft = 0;
+	}
+	
+	// Move the value nSamples samples along the ramp.
+	void advance(int nSamples) {
+		if (nSamples >= nLeft)
+			finish();
+		else {
+			nLeft -= nSamples;
+			value = (multiplicative)
+			        ? value * std::pow(step, (float) nSamples)
+			        : value + nSamples*step;
+		}
+	}
+};
+
 enum SignCode {kPosPos, kPosNeg, kNegPos, kNegNeg};
 
 WP_EXT_INLINE unsigned int signs(float a, float b) {return (a < 0.0f) << 1 | (b < 0.0f);}
@@ -83,17 +145,71 @@ public:
 	void setValue(float *vp) {value = vp;}
 };
 
+// Position in a cycle as a 32-bit fixed-point fraction of the cycle. Phase 0 is x = -1
+// and a whole cycle is 2^32, so phases wrap around by unsigned overflow.
+WP_EXT_INLINE unsigned int xToPhase(float x) {
+	// Adding 3 keeps the product positive for x >= -3 and only adds whole cycles.
+	return (unsigned int) (long long) ((x + 3.0f) * 2147483648.0f);
+}
+
+// Phase increment between n evenly spaced points in a cycle.
+WP_EXT_INLINE unsigned int cyclePhaseIncrement(float n) {
+	return (unsigned int) (long long) (4294967296.0 / n + 0.5);
+}
+
+enum InterpolationMode {
+	kInterpNone,
+	kInterpLinear,
+	kInterpHermite,  // 4-point cubic Hermite (Catmull-Rom).
+	kInterpLagrange, // 4-point Lagrange.
+	kInterpSinc,     // 8-point Blackman windowed sinc.
+	
+	kNumInterpModes
+};
+
+extern const char *const interpolationModeNames[kNumInterpModes];
+
+// The kernels are tabulated for WP_INTERP_PHASES + 1 evenly spaced fractional positions.
+#define WP_INTERP_PHASES 1024
+
+// Returns the coefficient table of an interpolation kernel and sets taps to its length,
+// or returns NULL for kInterpNone and kInterpLinear. Row p of the table holds the weights
+// of the samples at offsets 1 - taps/2 to taps/2 for fractional position p/WP_INTERP_PHASES.
+const float *getInterpolationKernel(InterpolationMode mode, int &taps);
+
 class FunctionFunction {
 private:
 	unsigned int interpolation;
-	unsigned int fSize;
-	float fSizeCoefficient, *function;
+	unsigned int fSize, version;
+	float *function;
+	
+	InterpolationMode interpolationMode;
+	int kernelTaps;
+	const float *kernel;
 	
 public:
-	FunctionFunction() : interpolation(false), fSize(0), fSizeCoefficient(0.0f), function(NULL) {}
+	FunctionFunction()
+		: interpolation(false), fSize(0), version(0), function(NULL),
+		  interpolationMode(kInterpNone), kernelTaps(0), kernel(NULL) {}
 	
 	bool getInterpolation() {return interpolation;}
-	void setInterpolation(bool onOff) {interpolation = onOff;}
+	InterpolationMode getInterpolationMode() {return interpolationMode;}
+	
+	unsigned int getSize() {return fSize;}
+	const float *getSamples() {return function;}
+	
+	// Off is kInterpNone and on is kInterpLinear.
+	void setInterpolation(bool onOff) {setInterpolationMode((onOff) ? kInterpLinear : kInterpNone);}
+	
+	void setInterpolationMode(InterpolationMode mode) {
+		interpolationMode = mode;
+		interpolation = mode != kInterpNone;
+		kernel = getInterpolationKernel(mode, kernelTaps);
+		version++;
+	}
+	
+	// Incremented whenever the function is changed through this object.
+	unsigned int getVersion() {return version;}
 	
 	// f must point to a buffer containing fSizePlus1 samples.
 	// The last sample in the buffer (at offset (fSizePlus1 - 1))
@@ -106,17 +222,56 @@ public:
 	// must be the first sample of the next waveform.
 	void setFunction(int fSizePlus1, float *f) {
 		fSize = (unsigned int) (fSizePlus1 - 1);
-		fSizeCoefficient = 0.5f * fSize;
 		function = f;
+		version++;
 	}
 	
-	float getValue(float x) {
-		float sampleIndexF;
-		float sampleWeight = std::modf(fSizeCoefficient * (x + 3.0f), &sampleIndexF);
-		float *sample = function + (unsigned int) sampleIndexF % fSize;
+	// x must be >= -3. The function repeats with period 2.
+	float getValue(float x) {return getValueAtPhase(xToPhase(x));}
+	
+	// The sample index is the high word of phase*fSize and the weight the low word,
+	// so no modulo is needed.
+	float getValueAtPhase(unsigned int phase) {
+		unsigned long long position = (unsigned long long) phase * fSize;
+		unsigned int sampleIndex = (unsigned int) (position >> 32);
+		float sampleWeight = (float) ((unsigned int) position >> 8) * (1.0f / 16777216.0f);
+		
+		if (kernel != NULL)
+			return getKernelValue(sampleIndex, sampleWeight);
+		
+		float *sample = function + sampleIndex;
 		
 		return *sample + sampleWeight * (*(sample + interpolation) - *sample);
 	}
+	
+	float getKernelValue(unsigned int sampleIndex, float sampleWeight) {
+		const float *c = kernel + (int) (sampleWeight*WP_INTERP_PHASES + 0.5f)*kernelTaps;
+		
+		// Adding kernelTaps*fSize keeps the first tap index positive for tiny functions.
+		unsigned int index = (sampleIndex + kernelTaps*fSize - (kernelTaps/2 - 1)) % fSize;
+		float acc = 0.0f;
+		
+		for (int k = 0; k < kernelTaps; k++) {
+			acc += c[k] * function[index];
+			index++;
+			index -= (index >= fSize) ? fSize : 0; // Compiles to a conditional move.
+		}
+		return acc;
+	}
+	
+	// Values at phase, phase + phaseIncrement, ..., phase + (n-1)*phaseIncrement.
+	void getValues(unsigned int phase, unsigned int phaseIncrement, int n, float *out) {
+		for (int i = 0; i < n; i++) {
+			out[i] = getValueAtPhase(phase);
+			phase += phaseIncrement;
+		}
+	}
+	
+	// Values at x[0], ..., x[n-1].
+	void getValues(const float *x, int n, float *out) {
+		for (int i = 0; i < n; i++)
+			out[i] = getValue(x[i]);
+	}
 };
 
 #endif
@@ -0,0 +1,646 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "wpkernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define WP_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need to be told which instruction sets a function may use.
+// MSVC accepts the intrinsics anywhere.
+#ifdef __GNUC__
+#define WP_TARGET(isa) __attribute__((target(isa)))
+#else
+#define WP_TARGET(isa)
+#endif
+
+typedef void (*normfunc)(float *, int, float, float, float, float);
+typedef void (*lagfunc)(float *, int, int, int, const float *, int, int, float);
+typedef void (*addtablesfunc)(float *, int, const float *, const float *, float, float);
+typedef int (*trackfunc)(TrackerLanes &, const float *, int, unsigned int &);
+
+
+// ---<<< Scalar kernels >>>---
+static void normalizeWaveScalar(
+	float *wave, int n, float maxNormal, float normalizerGain, float limiterGain, float distLevel)
+{
+	for (int i = 0; i < n; i++) {
+		if (std::abs(wave[i]) > maxNormal) {
+			wave[i] *= limiterGain;
+			wave[i] += copysignf(distLevel, wave[i]);
+		}
+		else
+			wave[i] *= normalizerGain;
+	}
+}
+
+static void lagWaveScalar(
+	float *wave, int n, int first, int count,
+	const float *oldWave, int oldSize, int interpolation, float wNew)
+{
+	float step = (float) oldSize / n;
+	
+	for (int i = first; i < first + count; i++) {
+		float pos = i*step;
+		int k = std::min((int) pos, oldSize - 1);
+		float w = pos - k;
+		
+		const float *sample = oldWave + k;
+		float value = *sample + w*(*(sample + interpolation) - *sample);
+		value += wNew*(wave[i] - value);
+		wave[i] = copysignf(std::max(1.0e-8f, std::abs(value)), value);
+	}
+}
+
+static void addScaledTablesScalar(
+	float *dst, int n, const float *table0, const float *table1, float c0, float c1)
+{
+	for (int i = 0; i < n; i++)
+		dst[i] += c0*table0[i] + c1*table1[i];
+}
+
+static int trackLanesScalar(TrackerLanes &lanes, const float *in, int n, unsigned int &ended) {
+	ended = 0;
+	
+	for (int i = 0; i < n; i++, in += WP_TRACKER_LANES) {
+		for (int l = 0; l < WP_TRACKER_LANES; l++) {
+			float sample = in[l], absample = std::abs(sample);
+			lanes.previous[l] = sample;
+			
+			if (!lanes.active[l])
+				continue;
+			
+			float a = followAmplitude(lanes.amplitude[l], absample, lanes.aIncW[l], lanes.aDecW[l]);
+			lanes.amplitude[l] = a;
+			
+			if (lanes.disabled[l]) {
+				if (!(a > lanes.ampGate[l] | absample > lanes.sampleGate[l]))
+					continue;
+				
+				lanes.disabled[l] = 0;
+				lanes.trigCount[l] = 0;
+				lanes.detectPeak[l] = lanes.inverted[l];
+				lanes.size[l] = 0;
+				lanes.cycleStart[l] = 0.0f;
+				lanes.maxSample[l] = absample;
+			}
+			else if (a < lanes.ampGate[l] & absample < lanes.sampleGate[l]) {
+				lanes.disabled[l] = -1;
+				continue;
+			}
+			
+			lanes.record[l][lanes.size[l]++] = sample;
+			lanes.maxSample[l] = std::max(lanes.maxSample[l], absample);
+			
+			if (isCycleEnd(
+			        lanes.record[l], lanes.size[l], sample, lanes.minSize[l], lanes.maxSize[l],
+			        lanes.trigCount[l], (lanes.inverted[l]) ? kNegPos : kPosNeg))
+				ended |= 1u << l;
+			else if (lanes.trigCount[l] <= 1 &&
+			         isTriggerLevel(
+			             lanes.detectPeak[l] != 0, sample, a, lanes.highTrig[l], lanes.lowTrig[l])) {
+				lanes.detectPeak[l] = ~lanes.detectPeak[l];
+				lanes.trigCount[l]++;
+			}
+		}
+		
+		if (ended != 0)
+			return i + 1;
+	}
+	
+	return n;
+}
+
+
+#ifdef WP_X86_KERNELS
+// ---<<< SSE2 kernels >>>---
+// NOTE: Both kernels work on abs(x) and put the sign of x back with an XOR, which gives
+// exactly the same results as the scalar kernels without any branches.
+WP_TARGET("sse2")
+static void normalizeWaveSSE2(
+	float *wave, int n, float maxNormal, float normalizerGain, float limiterGain, float distLevel)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f), maxN = _mm_set1_ps(maxNormal),
+	             nGain = _mm_set1_ps(normalizerGain), lGain = _mm_set1_ps(limiterGain),
+	             dLevel = _mm_set1_ps(distLevel);
+	int i = 0;
+	
+	for (; i + 4 <= n; i += 4) {
+		__m128 x = _mm_loadu_ps(wave + i);
+		__m128 sign = _mm_and_ps(x, signMask), absX = _mm_andnot_ps(signMask, x);
+		__m128 limit = _mm_cmpgt_ps(absX, maxN);
+		__m128 normal = _mm_mul_ps(absX, nGain),
+		       limited = _mm_add_ps(_mm_mul_ps(absX, lGain), dLevel);
+		__m128 y = _mm_or_ps(_mm_and_ps(limit, limited), _mm_andnot_ps(limit, normal));
+		_mm_storeu_ps(wave + i, _mm_xor_ps(y, sign));
+	}
+	
+	normalizeWaveScalar(wave + i, n - i, maxNormal, normalizerGain, limiterGain, distLevel);
+}
+
+WP_TARGET("sse2")
+static void lagWaveSSE2(
+	float *wave, int n, int first, int count,
+	const float *oldWave, int oldSize, int interpolation, float wNew)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f), minLevel = _mm_set1_ps(1.0e-8f),
+	             wN = _mm_set1_ps(wNew), step = _mm_set1_ps((float) oldSize / n),
+	             four = _mm_set1_ps(4.0f);
+	const __m128i kMax = _mm_set1_epi32(oldSize - 1);
+	__m128 index = _mm_add_ps(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps((float) first));
+	int i = first, end = first + count, k[4];
+	
+	for (; i + 4 <= end; i += 4) {
+		__m128 pos = _mm_mul_ps(index, step);
+		__m128i kV = _mm_cvttps_epi32(pos);
+		__m128i over = _mm_cmpgt_epi32(kV, kMax);
+		kV = _mm_or_si128(_mm_and_si128(over, kMax), _mm_andnot_si128(over, kV));
+		__m128 w = _mm_sub_ps(pos, _mm_cvtepi32_ps(kV));
+		
+		// SSE2 has no gather instruction.
+		_mm_storeu_si128((__m128i *) k, kV);
+		__m128 s0 = _mm_setr_ps(oldWave[k[0]], oldWave[k[1]], oldWave[k[2]], oldWave[k[3]]);
+		__m128 s1 = _mm_setr_ps(
+			oldWave[k[0] + interpolation], oldWave[k[1] + interpolation],
+			oldWave[k[2] + interpolation], oldWave[k[3] + interpolation]);
+		
+		__m128 value = _mm_add_ps(s0, _mm_mul_ps(w, _mm_sub_ps(s1, s0)));
+		value = _mm_add_ps(value, _mm_mul_ps(wN, _mm_sub_ps(_mm_loadu_ps(wave + i), value)));
+		
+		__m128 sign = _mm_and_ps(value, signMask);
+		__m128 absValue = _mm_max_ps(_mm_andnot_ps(signMask, value), minLevel);
+		_mm_storeu_ps(wave + i, _mm_or_ps(absValue, sign));
+		
+		index = _mm_add_ps(index, four);
+	}
+	
+	lagWaveScalar(wave, n, i, end - i, oldWave, oldSize, interpolation, wNew);
+}
+
+WP_TARGET("sse2")
+static void addScaledTablesSSE2(
+	float *dst, int n, const float *table0, const float *table1, float c0, float c1)
+{
+	const __m128 c0V = _mm_set1_ps(c0), c1V = _mm_set1_ps(c1);
+	int i = 0;
+	
+	for (; i + 4 <= n; i += 4) {
+		__m128 y = _mm_add_ps(
+			_mm_mul_ps(c0V, _mm_loadu_ps(table0 + i)), _mm_mul_ps(c1V, _mm_loadu_ps(table1 + i)));
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), y));
+	}
+	
+	addScaledTablesScalar(dst + i, n - i, table0 + i, table1 + i, c0, c1);
+}
+
+// SSE2 has no blend instruction.
+WP_TARGET("sse2")
+static inline __m128 selectSSE2(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Steps lanes first to first+3 through one frame. Returns the bit mask of the lanes whose
+// cycle ended, relative to first. See trackLanesAVX2, which keeps all eight lanes in registers.
+WP_TARGET("sse2")
+static unsigned int trackFrameSSE2(TrackerLanes &lanes, int first, const float *in) {
+	const __m128 signMask = _mm_set1_ps(-0.0f), minLevel = _mm_set1_ps(WP_TRACKER_MIN_AMPLITUDE),
+	             zero = _mm_setzero_ps();
+	const __m128i one = _mm_set1_epi32(1), allOnes = _mm_set1_epi32(-1),
+	              inverted = _mm_loadu_si128((const __m128i *) (lanes.inverted + first)),
+	              active = _mm_loadu_si128((const __m128i *) (lanes.active + first));
+	const __m128 ampGate = _mm_loadu_ps(lanes.ampGate + first),
+	             sampleGate = _mm_loadu_ps(lanes.sampleGate + first);
+	
+	__m128 x = _mm_loadu_ps(in + first), absX = _mm_andnot_ps(signMask, x),
+	       previous = _mm_loadu_ps(lanes.previous + first),
+	       a = _mm_loadu_ps(lanes.amplitude + first);
+	_mm_storeu_ps(lanes.previous + first, x);
+	
+	// Amplitude follower.
+	__m128 w = selectSSE2(
+		_mm_cmpgt_ps(absX, a), _mm_loadu_ps(lanes.aIncW + first), _mm_loadu_ps(lanes.aDecW + first));
+	__m128 aNew = _mm_max_ps(_mm_add_ps(a, _mm_mul_ps(w, _mm_sub_ps(absX, a))), minLevel);
+	a = selectSSE2(_mm_castsi128_ps(active), aNew, a);
+	_mm_storeu_ps(lanes.amplitude + first, a);
+	
+	// Gate.
+	__m128i disabled = _mm_loadu_si128((const __m128i *) (lanes.disabled + first));
+	__m128i open = _mm_and_si128(
+		_mm_and_si128(disabled, active),
+		_mm_castps_si128(_mm_or_ps(_mm_cmpgt_ps(a, ampGate), _mm_cmpgt_ps(absX, sampleGate))));
+	__m128i close = _mm_andnot_si128(
+		disabled,
+		_mm_castps_si128(_mm_and_ps(_mm_cmplt_ps(a, ampGate), _mm_cmplt_ps(absX, sampleGate))));
+	disabled = _mm_or_si128(_mm_andnot_si128(open, disabled), close);
+	_mm_storeu_si128((__m128i *) (lanes.disabled + first), disabled);
+	
+	__m128i rec = _mm_andnot_si128(disabled, allOnes);
+	unsigned int recMask = _mm_movemask_ps(_mm_castsi128_ps(rec));
+	if (recMask == 0)
+		return 0;
+	
+	__m128i trigCount = _mm_andnot_si128(open, _mm_loadu_si128((const __m128i *) (lanes.trigCount + first))),
+	        detectPeak = _mm_loadu_si128((const __m128i *) (lanes.detectPeak + first)),
+	        size = _mm_andnot_si128(open, _mm_loadu_si128((const __m128i *) (lanes.size + first)));
+	detectPeak = _mm_or_si128(_mm_and_si128(open, inverted), _mm_andnot_si128(open, detectPeak));
+	__m128 maxS = selectSSE2(_mm_castsi128_ps(open), absX, _mm_loadu_ps(lanes.maxSample + first));
+	_mm_storeu_ps(
+		lanes.cycleStart + first,
+		_mm_andnot_ps(_mm_castsi128_ps(open), _mm_loadu_ps(lanes.cycleStart + first)));
+	
+	// Recording. The stores are scattered over the lanes' buffers.
+	int sizes[4];
+	float samples[4];
+	_mm_storeu_si128((__m128i *) sizes, size);
+	_mm_storeu_ps(samples, x);
+	for (int l = 0; l < 4; l++) {
+		if (recMask & 1u << l)
+			lanes.record[first + l][sizes[l]] = samples[l];
+	}
+	size = _mm_sub_epi32(size, rec);
+	maxS = selectSSE2(_mm_castsi128_ps(rec), _mm_max_ps(absX, maxS), maxS);
+	
+	// Cycle end.
+	__m128i negative = _mm_castps_si128(_mm_cmplt_ps(x, zero));
+	__m128i crossing = _mm_and_si128(
+		_mm_xor_si128(_mm_castps_si128(_mm_cmplt_ps(previous, zero)), negative),
+		_mm_xor_si128(negative, inverted));
+	__m128i counted = _mm_cmpgt_epi32(trigCount, one);
+	__m128i full = _mm_andnot_si128(
+		_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *) (lanes.maxSize + first)), size), allOnes);
+	__m128i longEnough = _mm_andnot_si128(
+		_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *) (lanes.minSize + first)), size), allOnes);
+	__m128i end = _mm_and_si128(
+		rec, _mm_or_si128(full, _mm_and_si128(_mm_and_si128(counted, longEnough), crossing)));
+	
+	// Peak detection.
+	__m128 high = _mm_castsi128_ps(detectPeak);
+	__m128 level = selectSSE2(
+		high, _mm_mul_ps(a, _mm_loadu_ps(lanes.highTrig + first)),
+		_mm_mul_ps(a, _mm_loadu_ps(lanes.lowTrig + first)));
+	__m128 beyond = selectSSE2(high, _mm_cmpgt_ps(x, level), _mm_cmplt_ps(x, level));
+	__m128i peak = _mm_andnot_si128(_mm_or_si128(end, counted), _mm_and_si128(rec, _mm_castps_si128(beyond)));
+	detectPeak = _mm_xor_si128(detectPeak, peak);
+	trigCount = _mm_sub_epi32(trigCount, peak);
+	
+	_mm_storeu_si128((__m128i *) (lanes.trigCount + first), trigCount);
+	_mm_storeu_si128((__m128i *) (lanes.detectPeak + first), detectPeak);
+	_mm_storeu_si128((__m128i *) (lanes.size + first), size);
+	_mm_storeu_ps(lanes.maxSample + first, maxS);
+	
+	return _mm_movemask_ps(_mm_castsi128_ps(end));
+}
+
+WP_TARGET("sse2")
+static int trackLanesSSE2(TrackerLanes &lanes, const float *in, int n, unsigned int &ended) {
+	ended = 0;
+	
+	for (int i = 0; i < n; i++, in += WP_TRACKER_LANES) {
+		ended = trackFrameSSE2(lanes, 0, in) | trackFrameSSE2(lanes, 4, in) << 4;
+		if (ended != 0)
+			return i + 1;
+	}
+	
+	return n;
+}
+
+
+// ---<<< AVX2 kernels >>>---
+WP_TARGET("avx2")
+static void normalizeWaveAVX2(
+	float *wave, int n, float maxNormal, float normalizerGain, float limiterGain, float distLevel)
+{
+	const __m256 signMask = _mm256_set1_ps(-0.0f), maxN = _mm256_set1_ps(maxNormal),
+	             nGain = _mm256_set1_ps(normalizerGain), lGain = _mm256_set1_ps(limiterGain),
+	             dLevel = _mm256_set1_ps(distLevel);
+	int i = 0;
+	
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_loadu_ps(wave + i);
+		__m256 sign = _mm256_and_ps(x, signMask), absX = _mm256_andnot_ps(signMask, x);
+		__m256 limit = _mm256_cmp_ps(absX, maxN, _CMP_GT_OQ);
+		__m256 normal = _mm256_mul_ps(absX, nGain),
+		       limited = _mm256_add_ps(_mm256_mul_ps(absX, lGain), dLevel);
+		__m256 y = _mm256_blendv_ps(normal, limited, limit);
+		_mm256_storeu_ps(wave + i, _mm256_xor_ps(y, sign));
+	}
+	
+	normalizeWaveScalar(wave + i, n - i, maxNormal, normalizerGain, limiterGain, distLevel);
+}
+
+WP_TARGET("avx2")
+static void lagWaveAVX2(
+	float *wave, int n, int first, int count,
+	const float *oldWave, int oldSize, int interpolation, float wNew)
+{
+	const __m256 signMask = _mm256_set1_ps(-0.0f), minLevel = _mm256_set1_ps(1.0e-8f),
+	             wN = _mm256_set1_ps(wNew), step = _mm256_set1_ps((float) oldSize / n),
+	             eight = _mm256_set1_ps(8.0f);
+	const __m256i kMax = _mm256_set1_epi32(oldSize - 1), interp = _mm256_set1_epi32(interpolation);
+	__m256 index = _mm256_add_ps(
+		_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f), _mm256_set1_ps((float) first));
+	int i = first, end = first + count;
+	
+	for (; i + 8 <= end; i += 8) {
+		__m256 pos = _mm256_mul_ps(index, step);
+		__m256i k = _mm256_min_epi32(_mm256_cvttps_epi32(pos), kMax);
+		__m256 w = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(k));
+		
+		__m256 s0 = _mm256_i32gather_ps(oldWave, k, 4),
+		       s1 = _mm256_i32gather_ps(oldWave, _mm256_add_epi32(k, interp), 4);
+		
+		__m256 value = _mm256_add_ps(s0, _mm256_mul_ps(w, _mm256_sub_ps(s1, s0)));
+		value = _mm256_add_ps(
+			value, _mm256_mul_ps(wN, _mm256_sub_ps(_mm256_loadu_ps(wave + i), value)));
+		
+		__m256 sign = _mm256_and_ps(value, signMask);
+		__m256 absValue = _mm256_max_ps(_mm256_andnot_ps(signMask, value), minLevel);
+		_mm256_storeu_ps(wave + i, _mm256_or_ps(absValue, sign));
+		
+		index = _mm256_add_ps(index, eight);
+	}
+	
+	lagWaveScalar(wave, n, i, end - i, oldWave, oldSize, interpolation, wNew);
+}
+
+// NOTE: No FMA, so the results are the same as those of the other kernels.
+WP_TARGET("avx2")
+static void addScaledTablesAVX2(
+	float *dst, int n, const float *table0, const float *table1, float c0, float c1)
+{
+	const __m256 c0V = _mm256_set1_ps(c0), c1V = _mm256_set1_ps(c1);
+	int i = 0;
+	
+	for (; i + 8 <= n; i += 8) {
+		__m256 y = _mm256_add_ps(
+			_mm256_mul_ps(c0V, _mm256_loadu_ps(table0 + i)),
+			_mm256_mul_ps(c1V, _mm256_loadu_ps(table1 + i)));
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), y));
+	}
+	
+	addScaledTablesScalar(dst + i, n - i, table0 + i, table1 + i, c0, c1);
+}
+// NOTE: The state stays in registers over the frames. Lanes that don't record (most of them
+// while the input is gated) skip the scattered stores and cycle end checks.
+WP_TARGET("avx2")
+static int trackLanesAVX2(TrackerLanes &lanes, const float *in, int n, unsigned int &ended) {
+	const __m256 signMask = _mm256_set1_ps(-0.0f), minLevel = _mm256_set1_ps(WP_TRACKER_MIN_AMPLITUDE),
+	             zero = _mm256_setzero_ps(),
+	             aIncW = _mm256_loadu_ps(lanes.aIncW), aDecW = _mm256_loadu_ps(lanes.aDecW),
+	             ampGate = _mm256_loadu_ps(lanes.ampGate), sampleGate = _mm256_loadu_ps(lanes.sampleGate),
+	             highTrig = _mm256_loadu_ps(lanes.highTrig), lowTrig = _mm256_loadu_ps(lanes.lowTrig);
+	const __m256i one = _mm256_set1_epi32(1), allOnes = _mm256_set1_epi32(-1),
+	              inverted = _mm256_loadu_si256((const __m256i *) lanes.inverted),
+	              minSize = _mm256_loadu_si256((const __m256i *) lanes.minSize),
+	              maxSize = _mm256_loadu_si256((const __m256i *) lanes.maxSize),
+	              active = _mm256_loadu_si256((const __m256i *) lanes.active);
+	
+	__m256 a = _mm256_loadu_ps(lanes.amplitude), maxS = _mm256_loadu_ps(lanes.maxSample),
+	       cycleStart = _mm256_loadu_ps(lanes.cycleStart), previous = _mm256_loadu_ps(lanes.previous);
+	__m256i disabled = _mm256_loadu_si256((const __m256i *) lanes.disabled),
+	        detectPeak = _mm256_loadu_si256((const __m256i *) lanes.detectPeak),
+	        trigCount = _mm256_loadu_si256((const __m256i *) lanes.trigCount),
+	        size = _mm256_loadu_si256((const __m256i *) lanes.size);
+	
+	int sizes[WP_TRACKER_LANES], i = 0;
+	float samples[WP_TRACKER_LANES];
+	unsigned int endMask = 0;
+	
+	while (i < n && endMask == 0) {
+		__m256 x = _mm256_loadu_ps(in + i*WP_TRACKER_LANES), absX = _mm256_andnot_ps(signMask, x);
+		i++;
+		
+		// Amplitude follower.
+		__m256 w = _mm256_blendv_ps(aDecW, aIncW, _mm256_cmp_ps(absX, a, _CMP_GT_OQ));
+		__m256 aNew = _mm256_max_ps(_mm256_add_ps(a, _mm256_mul_ps(w, _mm256_sub_ps(absX, a))), minLevel);
+		a = _mm256_blendv_ps(a, aNew, _mm256_castsi256_ps(active));
+		
+		// Gate.
+		__m256i open = _mm256_and_si256(
+			_mm256_and_si256(disabled, active),
+			_mm256_castps_si256(_mm256_or_ps(
+				_mm256_cmp_ps(a, ampGate, _CMP_GT_OQ), _mm256_cmp_ps(absX, sampleGate, _CMP_GT_OQ))));
+		__m256i close = _mm256_andnot_si256(
+			disabled,
+			_mm256_castps_si256(_mm256_and_ps(
+				_mm256_cmp_ps(a, ampGate, _CMP_LT_OQ), _mm256_cmp_ps(absX, sampleGate, _CMP_LT_OQ))));
+		disabled = _mm256_or_si256(_mm256_andnot_si256(open, disabled), close);
+		
+		__m256i rec = _mm256_andnot_si256(disabled, allOnes);
+		unsigned int recMask = _mm256_movemask_ps(_mm256_castsi256_ps(rec));
+		
+		if (recMask != 0) {
+			trigCount = _mm256_andnot_si256(open, trigCount);
+			detectPeak = _mm256_blendv_epi8(detectPeak, inverted, open);
+			size = _mm256_andnot_si256(open, size);
+			cycleStart = _mm256_andnot_ps(_mm256_castsi256_ps(open), cycleStart);
+			maxS = _mm256_blendv_ps(maxS, absX, _mm256_castsi256_ps(open));
+			
+			// Recording. AVX2 has no scatter instruction.
+			_mm256_storeu_si256((__m256i *) sizes, size);
+			_mm256_storeu_ps(samples, x);
+			for (int l = 0; l < WP_TRACKER_LANES; l++) {
+				if (recMask & 1u << l)
+					lanes.record[l][sizes[l]] = samples[l];
+			}
+			size = _mm256_sub_epi32(size, rec);
+			maxS = _mm256_blendv_ps(maxS, _mm256_max_ps(absX, maxS), _mm256_castsi256_ps(rec));
+			
+			// Cycle end.
+			__m256i negative = _mm256_castps_si256(_mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+			__m256i crossing = _mm256_and_si256(
+				_mm256_xor_si256(_mm256_castps_si256(_mm256_cmp_ps(previous, zero, _CMP_LT_OQ)), negative),
+				_mm256_xor_si256(negative, inverted));
+			__m256i counted = _mm256_cmpgt_epi32(trigCount, one);
+			__m256i full = _mm256_andnot_si256(_mm256_cmpgt_epi32(maxSize, size), allOnes);
+			__m256i longEnough = _mm256_andnot_si256(_mm256_cmpgt_epi32(minSize, size), allOnes);
+			__m256i end = _mm256_and_si256(
+				rec, _mm256_or_si256(full, _mm256_and_si256(_mm256_and_si256(counted, longEnough), crossing)));
+			
+			// Peak detection.
+			__m256 high = _mm256_castsi256_ps(detectPeak);
+			__m256 level = _mm256_blendv_ps(_mm256_mul_ps(a, lowTrig), _mm256_mul_ps(a, highTrig), high);
+			__m256 beyond = _mm256_blendv_ps(
+				_mm256_cmp_ps(x, level, _CMP_LT_OQ), _mm256_cmp_ps(x, level, _CMP_GT_OQ), high);
+			__m256i peak = _mm256_andnot_si256(
+				_mm256_or_si256(end, counted), _mm256_and_si256(rec, _mm256_castps_si256(beyond)));
+			detectPeak = _mm256_xor_si256(detectPeak, peak);
+			trigCount = _mm256_sub_epi32(trigCount, peak);
+			
+			endMask = _mm256_movemask_ps(_mm256_castsi256_ps(end));
+		}
+		
+		previous = x;
+	}
+	
+	_mm256_storeu_ps(lanes.amplitude, a);
+	_mm256_storeu_ps(lanes.maxSample, maxS);
+	_mm256_storeu_ps(lanes.cycleStart, cycleStart);
+	_mm256_storeu_ps(lanes.previous, previous);
+	_mm256_storeu_si256((__m256i *) lanes.disabled, disabled);
+	_mm256_storeu_si256((__m256i *) lanes.detectPeak, detectPeak);
+	_mm256_storeu_si256((__m256i *) lanes.trigCount, trigCount);
+	_mm256_storeu_si256((__m256i *) lanes.size, size);
+	
+	ended = endMask;
+	return i;
+}
+#endif
+
+
+// ---<<< Runtime selection >>>---
+struct WaveKernels {
+	normfunc normalize;
+	lagfunc lag;
+	addtablesfunc addTables;
+	trackfunc track;
+	const char *name;
+};
+
+#ifdef WP_X86_KERNELS
+static bool cpuHasSSE2() {
+#if defined(__GNUC__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+#elif defined(_M_X64)
+	return true;
+#else
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] >> 26) & 1;
+#endif
+}
+
+static bool cpuHasAVX2() {
+#if defined(__GNUC__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	
+	// The OS must also save the AVX registers on context switches.
+	__cpuid(info, 1);
+	if (!((info[2] >> 27) & 1) || !((info[2] >> 28) & 1) || (_xgetbv(0) & 6) != 6)
+		return false;
+	
+	__cpuidex(info, 7, 0);
+	return (info[1] >> 5) & 1;
+#endif
+}
+#endif
+
+const char *const kernelSetNames[kNumKernelSets] = {"scalar", "SSE2", "AVX2"};
+
+// Fills in the kernels of set. Returns false if the CPU can't run them.
+static bool getKernelSet(KernelSet set, WaveKernels &kernels) {
+	switch (set) {
+		case kKernelsScalar:
+		kernels.normalize = &normalizeWaveScalar;
+		kernels.lag = &lagWaveScalar;
+		kernels.addTables = &addScaledTablesScalar;
+		kernels.track = &trackLanesScalar;
+		break;
+		
+#ifdef WP_X86_KERNELS
+		case kKernelsSSE2:
+		if (!cpuHasSSE2())
+			return false;
+		kernels.normalize = &normalizeWaveSSE2;
+		kernels.lag = &lagWaveSSE2;
+		kernels.addTables = &addScaledTablesSSE2;
+		kernels.track = &trackLanesSSE2;
+		break;
+		
+		case kKernelsAVX2:
+		if (!cpuHasAVX2())
+			return false;
+		kernels.normalize = &normalizeWaveAVX2;
+		kernels.lag = &lagWaveAVX2;
+		kernels.addTables = &addScaledTablesAVX2;
+		kernels.track = &trackLanesAVX2;
+		break;
+#endif
+		
+		default:
+		return false;
+	}
+	
+	kernels.name = kernelSetNames[set];
+	return true;
+}
+
+static WaveKernels selectWaveKernels() {
+	WaveKernels kernels;
+	
+	if (!getKernelSet(kKernelsAVX2, kernels) && !getKernelSet(kKernelsSSE2, kernels))
+		getKernelSet(kKernelsScalar, kernels);
+	
+	return kernels;
+}
+
+static const WaveKernels &getWaveKernels() {
+	static const WaveKernels kernels = selectWaveKernels();
+	return kernels;
+}
+
+void normalizeWave(
+	float *wave, int n, float maxNormal, float normalizerGain, float limiterGain, float distLevel)
+{
+	getWaveKernels().normalize(wave, n, maxNormal, normalizerGain, limiterGain, distLevel);
+}
+
+void lagWave(
+	float *wave, int n, int first, int count,
+	const float *oldWave, int oldSize, int interpolation, float wNew)
+{
+	getWaveKernels().lag(wave, n, first, count, oldWave, oldSize, interpolation, wNew);
+}
+
+void addScaledTables(float *dst, int n, const float *table0, const float *table1, float c0, float c1) {
+	getWaveKernels().addTables(dst, n, table0, table1, c0, c1);
+}
+
+int trackLanes(TrackerLanes &lanes, const float *in, int n, unsigned int &ended) {
+	return getWaveKernels().track(lanes, in, n, ended);
+}
+
+const char *getWaveKernelsName() {return getWaveKernels().name;}
+
+bool isKernelSetSupported(KernelSet set) {
+	WaveKernels kernels;
+	return getKernelSet(set, kernels);
+}
+
+int trackLanesWith(KernelSet set, TrackerLanes &lanes, const float *in, int n, unsigned int &ended) {
+	WaveKernels kernels;
+	getKernelSet(set, kernels);
+	return kernels.track(lanes, in, n, ended);
+}
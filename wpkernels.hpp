@@ -0,0 +1,138 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_WPKERNELS_HPP
+#define WP_WPKERNELS_HPP
+
+#include "wpfunc.hpp"
+
+// Waveform kernels used by the Analyzer when a cycle has been captured and by the
+// Synthesizer's cycle boundary smoothing. Each kernel has scalar, SSE2 and AVX2
+// implementations. The fastest one supported by the CPU is selected the first time the
+// kernels are used.
+
+// Normalizes samples with signal level up to maxNormal by multiplying with normalizerGain
+// and limits samples above it to sign(w)*(limiterGain*abs(w) + distLevel).
+void normalizeWave(
+	float *wave, int n, float maxNormal, float normalizerGain, float limiterGain, float distLevel);
+
+// Blends the n samples in wave with the waveform in oldWave, resampled to n points,
+// and keeps the result out of the denormal range:
+//   v = old + wNew*(wave - old); wave = copysignf(max(1.0e-8f, abs(v)), v)
+// Only samples first to first+count-1 are processed, so the work can be split up.
+// oldWave must hold oldSize + 1 samples, like the buffer of a FunctionFunction.
+// interpolation is 0 (nearest) or 1 (linear).
+void lagWave(
+	float *wave, int n, int first, int count,
+	const float *oldWave, int oldSize, int interpolation, float wNew);
+
+// Adds two scaled tables to n samples: dst[i] += c0*table0[i] + c1*table1[i].
+void addScaledTables(float *dst, int n, const float *table0, const float *table1, float c0, float c1);
+
+// Per-sample steps of an analyzer's amplitude follower and crossing trigger, used by
+// Analyzer::addSample, Analyzer::processBlock and the scalar trackLanes alike. The SSE2 and
+// AVX2 versions of trackLanes do the same arithmetic on vectors.
+
+// Lower bound of the followed amplitude.
+#define WP_TRACKER_MIN_AMPLITUDE 1.0e-8f
+
+// Moves the amplitude a towards absample with weight incW when rising and decW when falling.
+inline float followAmplitude(float a, float absample, float incW, float decW) {
+	// NOTE: We make amplitude lower-bounded to stay out of cycle-sapping denormal territory.
+	// Each branch does its own multiply, which keeps compilers from turning the well-predicted
+	// branch into a select on the path from one amplitude to the next.
+	float step = (absample > a) ? incW*(absample - a) : decW*(absample - a);
+	return std::max(WP_TRACKER_MIN_AMPLITUDE, a + step);
+}
+
+// True if the cycle of size samples recorded in record ends with its last sample, sample:
+// when it's maxSize samples long, or when it's at least minSize samples long, the trigger has
+// seen a peak and a trough (trigCount > 1) and the last two samples cross zero as in
+// endOfCycle.
+inline bool isCycleEnd(
+	const float *record, int size, float sample, int minSize, int maxSize, int trigCount,
+	SignCode endOfCycle)
+{
+	return size >= maxSize ||
+	       (trigCount > 1 && size >= minSize && signs(record[size-2], sample) == endOfCycle);
+}
+
+// True if sample reaches the peak (detectPeak) or trough level the trigger waits for.
+inline bool isTriggerLevel(bool detectPeak, float sample, float a, float highTrig, float lowTrig) {
+	return (detectPeak) ? sample > a*highTrig : sample < a*lowTrig;
+}
+
+// Number of analyzers stepped side by side by trackLanes.
+#define WP_TRACKER_LANES 8
+
+// Amplitude followers, gates and zero-crossing cycle triggers of WP_TRACKER_LANES analyzers in
+// structure-of-arrays layout, one lane per analyzer. A lane steps like Analyzer::processBlock
+// in kTriggerCrossing mode. Masks are 0 or -1.
+struct TrackerLanes {
+	// Settings. minSize and maxSize are the shortest and longest cycles in samples.
+	float aIncW[WP_TRACKER_LANES], aDecW[WP_TRACKER_LANES],
+	      ampGate[WP_TRACKER_LANES], sampleGate[WP_TRACKER_LANES],
+	      highTrig[WP_TRACKER_LANES], lowTrig[WP_TRACKER_LANES];
+	int inverted[WP_TRACKER_LANES], minSize[WP_TRACKER_LANES], maxSize[WP_TRACKER_LANES];
+	
+	// Mask of the lanes to step. The others must be gated (disabled), and only previous changes.
+	int active[WP_TRACKER_LANES];
+	
+	// Tracker state. previous is the sample of the previous frame, which the vector kernels
+	// test crossings with. Crossings are only tested once a lane has recorded a peak and a
+	// trough since its gate opened or its cycle started, so previous is then the sample before
+	// the last one recorded, the one isCycleEnd tests.
+	float amplitude[WP_TRACKER_LANES], maxSample[WP_TRACKER_LANES],
+	      cycleStart[WP_TRACKER_LANES], previous[WP_TRACKER_LANES];
+	int disabled[WP_TRACKER_LANES], detectPeak[WP_TRACKER_LANES],
+	    trigCount[WP_TRACKER_LANES], size[WP_TRACKER_LANES];
+	
+	// Cycle recordings. A recorded sample is stored at record[l][size[l]] and size[l] incremented.
+	float *record[WP_TRACKER_LANES];
+};
+
+// The lane-parallel analyzer front end of WaveEngineBatch. Steps the lanes through up to n
+// frames of in, which holds WP_TRACKER_LANES interleaved samples per frame, and stops after the
+// first frame on which a cycle ends in any lane. Returns the number of frames stepped and sets
+// ended to the bit mask of the lanes whose cycle ended. The caller must start their next cycle
+// (see Analyzer::updateFreqAndWave) before stepping again.
+int trackLanes(TrackerLanes &lanes, const float *in, int n, unsigned int &ended);
+
+// Name of the selected implementation ("AVX2", "SSE2" or "scalar").
+const char *getWaveKernelsName();
+
+// Implementations of the kernels.
+enum KernelSet {
+	kKernelsScalar,
+	kKernelsSSE2,
+	kKernelsAVX2,
+	
+	kNumKernelSets
+};
+
+extern const char *const kernelSetNames[kNumKernelSets];
+
+// For checking the implementations against each other (see WaveCheckMain.cpp): whether the
+// CPU can run set, and trackLanes with set instead of the selected implementation. set must
+// be supported.
+bool isKernelSetSupported(KernelSet set);
+int trackLanesWith(KernelSet set, TrackerLanes &lanes, const float *in, int n, unsigned int &ended);
+
+#endif
@@ -20,6 +20,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include "wpmodulators.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 const char *const modTypeUNames[kNModTypesU] = {
@@ -37,6 +38,7 @@ const char *const modTypeFNames[kNModTypesF] = {
 
 // ---<<< Modulator >>>---
 void Modulator::initialize(float lfoDiv, bool lfoRateDependent) {
+	mixRamp = ParameterRamp(kRampLinear, 0.0f);
 	lfoIncrement = 0.0f;
 	lfoDivisor = lfoDiv;
 	mix1 = 1.0f;
@@ -48,6 +50,20 @@ void Modulator::initialize(float lfoDiv, bool lfoRateDependent) {
 }
 
 void Modulator::setMix(float mx) {
+	mixRamp.setTarget(mx);
+	setMixValues(mixRamp.getValue());
+}
+
+bool Modulator::advanceMix(int nSamples) {
+	if (!mixRamp.isRamping())
+		return false;
+	
+	mixRamp.advance(nSamples);
+	setMixValues(mixRamp.getValue());
+	return true;
+}
+
+void Modulator::setMixValues(float mx) {
 	mix1 = 1.0f - mx;
 	mix2 = mx;
 	mixDist = std::pow(2.0f, 4.0f*mx) - 1.0f;
@@ -154,29 +170,68 @@ const SignedModulator::fmethod SignedModulator::modFunctions[kNModTypesS] = {
 	&SignedModulator::computePong
 };
 
+const SignedModulator::bmethod SignedModulator::blockFunctions[kNModTypesS] = {
+	&SignedModulator::computeAddBlock,
+	&SignedModulator::computeDiffBlock,
+	&SignedModulator::computeMultBlock,
+	&SignedModulator::computeDistBlock,
+	&SignedModulator::computeTopBlock,
+	&SignedModulator::computePongBlock
+};
+
 void SignedModulator::initialize(RealFunction *input1, RealFunction *input2, float lfoDiv) {
 	Modulator::initialize(lfoDiv, true);
 	
 	in1 = input1;
 	in2 = input2;
+	mixStep = 0.0f;
 	
 	setModulation(kModTypeSAdd);
 }
 
 void SignedModulator::setModulation(ModulationTypeS mt) {
 	modType = mt;
-	
-	computeValue = modFunctions[modType];
-	if (modType == kModTypeSAdd & mix2 == 0.0f)
-		computeValue = &SignedModulator::computeIdentity;
+	selectFunctions();
 }
 
 void SignedModulator::setMix(float mx) {
 	Modulator::setMix(mx);
+	selectFunctions();
+}
+
+bool SignedModulator::advanceMix(int nSamples) {
+	if (!Modulator::advanceMix(nSamples))
+		return false;
 	
+	if (!mixRamp.isRamping()) // Ramp done.
+		selectFunctions();
+	return true;
+}
+
+void SignedModulator::processBlock(const float *in1Block, const float *in2Block, float *out, int n) {
+	// Ramp the mix over the first part of the block and use the target for the rest.
+	while (n > 0) {
+		int span = (mixRamp.isRamping()) ? std::min(n, mixRamp.getSamplesLeft()) : n;
+		
+		mixStep = mixRamp.getStep();
+		(this->*computeBlock)(in1Block, in2Block, out, span);
+		mixStep = 0.0f;
+		advanceMix(span);
+		
+		in1Block += span;
+		in2Block += span;
+		out += span;
+		n -= span;
+	}
+}
+
+void SignedModulator::selectFunctions() {
 	computeValue = modFunctions[modType];
-	if (modType == kModTypeSAdd & mix2 == 0.0f)
+	computeBlock = blockFunctions[modType];
+	if (modType == kModTypeSAdd & mix2 == 0.0f & !mixRamp.isRamping()) {
 		computeValue = &SignedModulator::computeIdentity;
+		computeBlock = &SignedModulator::computeIdentityBlock;
+	}
 }
 
 float SignedModulator::computeIdentity() {return in1->getValue();}
@@ -213,6 +268,78 @@ float SignedModulator::computePong() {
 	return v1 + tri*(v2 - v1);
 }
 
+// The block methods are written as simple loops without calls or data dependencies
+// between iterations so the compiler can vectorize them.
+// The mix at sample i is mix2 + (i+1)*mixStep. mixStep is 0 unless the mix is ramping.
+void SignedModulator::computeIdentityBlock(const float *v1, const float *, float *out, int n) {
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i];
+}
+
+void SignedModulator::computeAddBlock(const float *v1, const float *v2, float *out, int n) {
+	float m2 = mix2, dm = mixStep;
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i] + (m2 + (i+1)*dm)*(v2[i] - v1[i]);
+}
+
+void SignedModulator::computeDiffBlock(const float *v1, const float *v2, float *out, int n) {
+	float m2 = mix2, dm = mixStep;
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i] + (m2 + (i+1)*dm)*(-v2[i] - v1[i]);
+}
+
+void SignedModulator::computeMultBlock(const float *v1, const float *v2, float *out, int n) {
+	float m2 = mix2, dm = mixStep;
+	for (int i = 0; i < n; i++) {
+		float m = m2 + (i+1)*dm;
+		out[i] = v1[i] * ((1.0f - m) + m*v2[i]);
+	}
+}
+
+void SignedModulator::computeDistBlock(const float *v1, const float *v2, float *out, int n) {
+	float mD = mixDist;
+	
+	if (mixStep != 0.0f) { // Ramping. mixDist must be computed for every sample.
+		float m2 = mix2, dm = mixStep;
+		for (int i = 0; i < n; i++) {
+			float vX = v1[i] * ((std::pow(2.0f, 4.0f*(m2 + (i+1)*dm)) - 1.0f)*std::abs(v2[i]) + 1.0f);
+			out[i] = vX / std::sqrt(vX*vX + 1.0f);
+		}
+		return;
+	}
+	
+	for (int i = 0; i < n; i++) {
+		float vX = v1[i] * (mD*std::abs(v2[i]) + 1.0f);
+		out[i] = vX / std::sqrt(vX*vX + 1.0f);
+	}
+}
+
+void SignedModulator::computeTopBlock(const float *v1, const float *v2, float *out, int n) {
+	float m2 = mix2, dm = mixStep;
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i] + (m2 + (i+1)*dm) * copysignf(v2[i], v1[i]) * (1.0f - std::abs(v1[i]));
+}
+
+void SignedModulator::computePongBlock(const float *v1, const float *v2, float *out, int n) {
+	// The LFO is generated as a ramp from its value at the start of the block
+	// instead of being stepped with updateLFO for every sample.
+	float saw0 = saw, inc = lfoIncrement;
+	
+	for (int i = 0; i < n; i++) {
+		float s = saw0 + (i+1)*inc;
+		s -= (float) (int) s; // Wrap to [0,1). The ramp is never negative.
+		
+		float t = 2.0f*((s > 0.5f) ? 1.0f - s : s);
+		out[i] = v1[i] + t*(v2[i] - v1[i]);
+	}
+	
+	if (n > 0) {
+		saw = saw0 + n*inc;
+		saw -= (float) (int) saw;
+		tri = 2.0f*((saw > 0.5f) ? 1.0f - saw : saw);
+	}
+}
+
 
 // ---<<< FunctionModulator >>>---
 const FunctionModulator::fmethodf FunctionModulator::modFunctions[kNModTypesF] = {
@@ -226,38 +353,119 @@ const FunctionModulator::fmethodf FunctionModulator::modFunctions[kNModTypesF] =
 	&FunctionModulator::computePong
 };
 
+const FunctionModulator::bmethod FunctionModulator::blockFunctions[kNModTypesF] = {
+	&FunctionModulator::computeAddBlock,
+	&FunctionModulator::computeDiffBlock,
+	&FunctionModulator::computeMultBlock,
+	&FunctionModulator::computeDistBlock,
+	&FunctionModulator::computeTopBlock,
+	&FunctionModulator::computeCompBlock,
+	&FunctionModulator::computeConvBlock,
+	&FunctionModulator::computePongBlock
+};
+
 void FunctionModulator::initialize(FunctionFunction *input1, FunctionFunction *input2, float lfoDiv) {
 	Modulator::initialize(lfoDiv, true);
 	
 	in1 = input1;
 	in2 = input2;
-	cycleDelta = -1.0f;
-	halfIRWidth = -1.0f;
+	stateVersion = 0;
+	phaseIncrement = 0;
 	hSizeI = 2;
 	hSizeF = 2.0f;
 	hDelta = 1.0f;
+	convPoints = 1;
+	convStart = 0;
+	convCount = 0;
+	renderPoint = 0;
 	
 	setModulation(kModTypeFAdd);
 }
 
 void FunctionModulator::setModulation(ModulationTypeF mt) {
 	modType = mt;
-	
-	computeValue = modFunctions[modType];
-	if (modType == kModTypeFAdd & mix2 == 0.0f)
-		computeValue = &FunctionModulator::computeIdentity;
+	convCount = 0;
+	stateVersion++;
+	selectFunctions();
 }
 
 void FunctionModulator::setMix(float mx) {
 	Modulator::setMix(mx);
+	setIRSize();
+	selectFunctions();
+	stateVersion++;
+}
+
+bool FunctionModulator::advanceMix(int nSamples) {
+	if (!Modulator::advanceMix(nSamples))
+		return false;
 	
-	hSizeF = 2.0f + std::floor(28.0f*mx);
+	setIRSize();
+	if (!mixRamp.isRamping()) // Ramp done.
+		selectFunctions();
+	stateVersion++;
+	return true;
+}
+
+void FunctionModulator::setIRSize() {
+	hSizeF = 2.0f + std::floor(28.0f*mix2);
 	hDelta = 2.0f / hSizeF;
 	hSizeI = (int) hSizeF;
+	convCount = 0;
+}
+
+void FunctionModulator::renderCycle(float *dst, int nPoints) {
+	while (nPoints > 0) {
+		int n = std::min(nPoints, WP_FMOD_BLOCK_SIZE);
+		
+		(this->*computeBlock)(dst, n);
+		renderPoint += n;
+		
+		dst += n;
+		nPoints -= n;
+	}
+}
+
+void FunctionModulator::renderSnapshot(float *dst, int nPoints, float lfoValue) {
+	unsigned int cycleIncrement = phaseIncrement;
+	int cyclePoints = convPoints, cyclePoint = renderPoint;
+	
+	setCycleSize((float) nPoints);
+	
+	if (modType == kModTypeFPong) {
+		while (renderPoint < nPoints) {
+			int n = std::min(nPoints - renderPoint, WP_FMOD_BLOCK_SIZE);
+			float *out = dst + renderPoint;
+			
+			fetchInputs(n);
+			for (int i = 0; i < n; i++)
+				out[i] = renderIn1[i] + lfoValue*(renderIn2[i] - renderIn1[i]);
+			renderPoint += n;
+		}
+	}
+	else
+		renderCycle(dst, nPoints);
 	
+	// NOTE: The Conv points computed for the snapshot are not those of the current cycle.
+	phaseIncrement = cycleIncrement;
+	convPoints = cyclePoints;
+	renderPoint = cyclePoint;
+	convCount = 0;
+}
+
+void FunctionModulator::advanceLFO(int nPoints) {
+	saw += nPoints*lfoIncrement;
+	saw -= (float) (int) saw;
+	tri = 2.0f*((saw > 0.5f) ? 1.0f - saw : saw);
+}
+
+void FunctionModulator::selectFunctions() {
 	computeValue = modFunctions[modType];
-	if (modType == kModTypeFAdd & mix2 == 0.0f)
+	computeBlock = blockFunctions[modType];
+	if (modType == kModTypeFAdd & mix2 == 0.0f & !mixRamp.isRamping()) {
 		computeValue = &FunctionModulator::computeIdentity;
+		computeBlock = &FunctionModulator::computeIdentityBlock;
+	}
 }
 
 float FunctionModulator::computeIdentity(float x) {return in1->getValue(x);}
@@ -294,23 +502,52 @@ float FunctionModulator::computeComp(float x) {
 	return v1 + mix2*(v2 - v1);
 }
 
+// Conv output for the cycle point nearest to x. The output is computed a block at a time.
 float FunctionModulator::computeConv(float x) {
-	float acc = 0.0f, cycleTau = x + halfIRWidth, hTau = 0.5f*hDelta - 1.0f;
-	if (cycleTau > 1.0f) // Treat in1 waveform as a periodic signal.
-		cycleTau -= 2.0f;
+	int point = (int) ((x + 1.0f)*0.5f*convPoints + 0.5f);
+	if (point >= convPoints)
+		point -= convPoints;
+	point = std::max(0, std::min(point, convPoints - 1));
+	
+	if ((unsigned int) (point - convStart) >= (unsigned int) convCount)
+		computeConvPoints(point);
+	
+	return convOut[point - convStart];
+}
+
+// Convolves in1 with the IR formed by taking hSize samples from in2. Each in1 sample is
+// used by hSize output points, so it is read once into convIn instead of hSize times.
+void FunctionModulator::computeConvPoints(int startPoint) {
+	int nPoints = std::min(convPoints - startPoint, WP_FMOD_BLOCK_SIZE);
+	int nIn = nPoints + hSizeI - 1;
 	
-	// Convolve in1 with the IR formed by taking hSize samples from in2.
+	// Reversed IR, scaled to make abs(output) <= output of an hSize-point averager.
+	float hTau = 0.5f*hDelta - 1.0f;
+	for (int k = hSizeI - 1; k >= 0; k--) {
+		convIR[k] = in2->getValue(hTau) / hSizeF;
+		hTau += hDelta;
+	}
+	
+	// The IR is centered on the output point. Phases wrap, so the in1 waveform is
+	// treated as a periodic signal.
+	unsigned int halfIRWidth =
+		(unsigned int) (((unsigned long long) (hSizeI - 1) * phaseIncrement) >> 1);
+	
+	in1->getValues(
+		(unsigned int) (startPoint - (hSizeI - 1))*phaseIncrement + halfIRWidth, phaseIncrement,
+		nIn, convIn);
+	
+	std::fill(convOut, convOut + nPoints, 0.0f);
 	for (int k = 0; k < hSizeI; k++) {
-		acc += in1->getValue(cycleTau) * in2->getValue(hTau);
+		float h = convIR[k];
+		const float *in = convIn + k;
 		
-		cycleTau -= cycleDelta;
-		if (cycleTau < -1.0f)
-			cycleTau += 2.0f;
-		hTau += hDelta;
+		for (int i = 0; i < nPoints; i++)
+			convOut[i] += h*in[i];
 	}
 	
-	// Make abs(output) <= output of an hSize-point averager to avoid overload.
-	return acc / hSizeF;
+	convStart = startPoint;
+	convCount = nPoints;
 }
 
 float FunctionModulator::computePong(float x) {
@@ -318,3 +555,110 @@ float FunctionModulator::computePong(float x) {
 	float v1 = in1->getValue(x), v2 = in2->getValue(x);
 	return v1 + tri*(v2 - v1);
 }
+
+// The block methods compute the points from renderPoint on.
+// Apart from fetching the inputs they are written as simple loops the compiler can vectorize.
+void FunctionModulator::fetchInputs(int n) {
+	unsigned int phase = renderPoint*phaseIncrement;
+	in1->getValues(phase, phaseIncrement, n, renderIn1);
+	in2->getValues(phase, phaseIncrement, n, renderIn2);
+}
+
+void FunctionModulator::computeIdentityBlock(float *out, int n) {
+	in1->getValues(renderPoint*phaseIncrement, phaseIncrement, n, out);
+}
+
+void FunctionModulator::computeAddBlock(float *out, int n) {
+	const float *v1 = renderIn1, *v2 = renderIn2;
+	float m2 = mix2;
+	
+	fetchInputs(n);
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i] + m2*(v2[i] - v1[i]);
+}
+
+void FunctionModulator::computeDiffBlock(float *out, int n) {
+	const float *v1 = renderIn1, *v2 = renderIn2;
+	float m2 = mix2;
+	
+	fetchInputs(n);
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i] + m2*(-v2[i] - v1[i]);
+}
+
+void FunctionModulator::computeMultBlock(float *out, int n) {
+	const float *v1 = renderIn1, *v2 = renderIn2;
+	float m1 = mix1, m2 = mix2;
+	
+	fetchInputs(n);
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i] * (m1 + m2*v2[i]);
+}
+
+void FunctionModulator::computeDistBlock(float *out, int n) {
+	const float *v1 = renderIn1, *v2 = renderIn2;
+	float mD = mixDist;
+	
+	fetchInputs(n);
+	for (int i = 0; i < n; i++) {
+		float vX = v1[i] * (mD*std::abs(v2[i]) + 1.0f);
+		out[i] = vX / std::sqrt(vX*vX + 1.0f);
+	}
+}
+
+void FunctionModulator::computeTopBlock(float *out, int n) {
+	const float *v1 = renderIn1, *v2 = renderIn2;
+	float m2 = mix2;
+	
+	fetchInputs(n);
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i] + m2 * copysignf(v2[i], v1[i]) * (1.0f - std::abs(v1[i]));
+}
+
+void FunctionModulator::computeCompBlock(float *out, int n) {
+	const float *v1 = renderIn1, *v2 = renderIn2;
+	float m2 = mix2;
+	
+	in1->getValues(renderPoint*phaseIncrement, phaseIncrement, n, renderIn1);
+	in2->getValues(renderIn1, n, renderIn2);
+	for (int i = 0; i < n; i++)
+		out[i] = v1[i] + m2*(v2[i] - v1[i]);
+}
+
+void FunctionModulator::computeConvBlock(float *out, int n) {
+	int point = renderPoint % convPoints;
+	
+	while (n > 0) {
+		if ((unsigned int) (point - convStart) >= (unsigned int) convCount)
+			computeConvPoints(point);
+		
+		int span = std::min(n, convStart + convCount - point);
+		std::copy(convOut + (point - convStart), convOut + (point - convStart + span), out);
+		
+		out += span;
+		n -= span;
+		point += span;
+		if (point == convPoints)
+			point = 0;
+	}
+}
+
+void FunctionModulator::computePongBlock(float *out, int n) {
+	const float *v1 = renderIn1, *v2 = renderIn2;
+	
+	fetchInputs(n);
+	
+	// The LFO is generated as a ramp from its value at the start of the block
+	// instead of being stepped with updateLFO for every point.
+	float saw0 = saw, inc = lfoIncrement;
+	
+	for (int i = 0; i < n; i++) {
+		float s = saw0 + (i+1)*inc;
+		s -= (float) (int) s; // Wrap to [0,1). The ramp is never negative.
+		
+		float t = 2.0f*((s > 0.5f) ? 1.0f - s : s);
+		out[i] = v1[i] + t*(v2[i] - v1[i]);
+	}
+	
+	advanceLFO(n);
+}
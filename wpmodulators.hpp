@@ -67,21 +67,36 @@ enum ModulationTypeF {
 
 extern const char *const modTypeFNames[kNModTypesF];
 
+// Largest Conv impulse response.
+#define WP_CONV_MAX_IR_SIZE 30
+
+// Number of cycle points FunctionModulator computes at a time.
+#define WP_FMOD_BLOCK_SIZE 256
+
 class Modulator {
 protected:
+	ParameterRamp mixRamp;
 	float mix1, mix2, mixDist, saw, tri, lfoIncrement, lfoDivisor;
 	bool rateDependentLFO;
 	
 public:
 	void initialize(float lfoDiv, bool lfoRateDependent);
 	
-	float getMix() {return mix2;}
+	float getMix() {return mixRamp.getTarget();}
 	void setMix(float mx);
 	
+	// Mix changes are ramped over this time. The ramp is moved along by advanceMix.
+	float getRampTime() {return mixRamp.getTime();}
+	void setRampTime(float seconds) {mixRamp.setTime(seconds);}
+	
+	// Returns true if the mix changed.
+	bool advanceMix(int nSamples);
+	
 	float getLFODivisor() {return lfoDivisor;}
-	void setLFODivisor(float divisor) {lfoDivisor = divisor; setMix(mix2);}
+	void setLFODivisor(float divisor) {lfoDivisor = divisor; setMixValues(mix2);}
 	
 protected:
+	void setMixValues(float mx);
 	inline void updateLFO();
 };
 
@@ -124,12 +139,18 @@ private:
 class SignedModulator : public Modulator {
 private:
 	typedef float (SignedModulator::*fmethod)();
+	typedef void (SignedModulator::*bmethod)(const float *, const float *, float *, int);
 	static const fmethod modFunctions[kNModTypesS];
+	static const bmethod blockFunctions[kNModTypesS];
 	
 	RealFunction *in1, *in2;
 	ModulationTypeS modType;
 	
 	fmethod computeValue;
+	bmethod computeBlock;
+	
+	// Change of mix2 per sample in the current block segment.
+	float mixStep;
 	
 public:
 	void initialize(
@@ -143,10 +164,17 @@ public:
 	void setModulation(ModulationTypeS mt);
 	
 	void setMix(float mx);
+	bool advanceMix(int nSamples);
 	
 	float getValue() {return (this->*computeValue)();}
 	
+	// Block version of getValue. Reads input 1 from in1Block and input 2 from in2Block
+	// instead of the input functions. Mix changes are ramped sample by sample.
+	void processBlock(const float *in1Block, const float *in2Block, float *out, int n);
+	
 private:
+	void selectFunctions();
+	
 	float computeIdentity();
 	float computeAdd();
 	float computeDiff();
@@ -154,41 +182,90 @@ private:
 	float computeDist();
 	float computeTop();
 	float computePong();
+	
+	void computeIdentityBlock(const float *v1, const float *v2, float *out, int n);
+	void computeAddBlock(const float *v1, const float *v2, float *out, int n);
+	void computeDiffBlock(const float *v1, const float *v2, float *out, int n);
+	void computeMultBlock(const float *v1, const float *v2, float *out, int n);
+	void computeDistBlock(const float *v1, const float *v2, float *out, int n);
+	void computeTopBlock(const float *v1, const float *v2, float *out, int n);
+	void computePongBlock(const float *v1, const float *v2, float *out, int n);
 };
 
 class FunctionModulator : public Modulator {
 private:
 	typedef float (FunctionModulator::*fmethodf)(float);
+	typedef void (FunctionModulator::*bmethod)(float *, int);
 	static const fmethodf modFunctions[kNModTypesF];
+	static const bmethod blockFunctions[kNModTypesF];
 	
 	FunctionFunction *in1, *in2;
 	ModulationTypeF modType;
+	unsigned int stateVersion;
 	int hSizeI;
-	float cycleDelta, halfIRWidth, hSizeF, hDelta;
+	unsigned int phaseIncrement; // Between the points of the current cycle.
+	float hSizeF, hDelta;
+	
+	// Conv output for points convStart to convStart + convCount - 1 of the current cycle,
+	// computed from the in1 samples in convIn and the reversed IR in convIR.
+	int convPoints, convStart, convCount;
+	float convIR[WP_CONV_MAX_IR_SIZE];
+	float convIn[WP_FMOD_BLOCK_SIZE + WP_CONV_MAX_IR_SIZE - 1];
+	float convOut[WP_FMOD_BLOCK_SIZE];
+	
+	// Next point of the current cycle for renderCycle, and input values for the block methods.
+	int renderPoint;
+	float renderIn1[WP_FMOD_BLOCK_SIZE], renderIn2[WP_FMOD_BLOCK_SIZE];
 	
 	fmethodf computeValue;
+	bmethod computeBlock;
 	
 public:
 	void initialize(
 		FunctionFunction *input1 = NULL, FunctionFunction *input2 = NULL,
 		float lfoDiv = 5000.0f);
 	
-	void setInput1(FunctionFunction *input) {in1 = input;}
-	void setInput2(FunctionFunction *input) {in2 = input;}
+	void setInput1(FunctionFunction *input) {in1 = input; stateVersion++;}
+	void setInput2(FunctionFunction *input) {in2 = input; stateVersion++;}
 	
 	ModulationTypeF getModulation() {return modType;}
 	void setModulation(ModulationTypeF mt);
 	
 	void setMix(float mx);
+	bool advanceMix(int nSamples);
+	
+	// Changes whenever the inputs or the settings change. The Pong LFO doesn't change it.
+	unsigned int getVersion() {return stateVersion + in1->getVersion() + in2->getVersion();}
+	
+	// The Pong LFO. Pong mode outputs in1 + lfo*(in2 - in1).
+	float getLFOValue() {return tri;}
+	
+	// Moves the LFO on by nPoints points, as rendering them would.
+	void advanceLFO(int nPoints);
 	
+	// The next nSamples calls to getValue will be made at x = -1 + i*2/nSamples, i = 0, 1, ...
+	// The waveforms of the inputs must not change until then.
 	void setCycleSize(float nSamples) {
-		cycleDelta = 2.0f/nSamples;
-		halfIRWidth = std::fmod(0.5f*(hSizeF-1.0f)*cycleDelta, 2.0f);
+		phaseIncrement = cyclePhaseIncrement(nSamples);
+		convPoints = std::max((int) (nSamples + 0.5f), 1);
+		convCount = 0;
+		renderPoint = 0;
 	}
 	
 	float getValue(float x) {return (this->*computeValue)(x);}
 	
+	// Writes the next nPoints points of the cycle started by setCycleSize to dst.
+	// Same as calling getValue for each point, but computed a block at a time.
+	void renderCycle(float *dst, int nPoints);
+	
+	// Writes a whole cycle of nPoints points to dst without moving the LFO or the current
+	// cycle along. In Pong mode the LFO is held at lfoValue.
+	void renderSnapshot(float *dst, int nPoints, float lfoValue);
+	
 private:
+	void setIRSize();
+	void selectFunctions();
+	
 	float computeIdentity(float x);
 	float computeAdd(float x);
 	float computeDiff(float x);
@@ -197,7 +274,20 @@ private:
 	float computeTop(float x);
 	float computeComp(float x);
 	float computeConv(float x);
+	void computeConvPoints(int startPoint);
 	float computePong(float x);
+	
+	void computeIdentityBlock(float *out, int n);
+	void computeAddBlock(float *out, int n);
+	void computeDiffBlock(float *out, int n);
+	void computeMultBlock(float *out, int n);
+	void computeDistBlock(float *out, int n);
+	void computeTopBlock(float *out, int n);
+	void computeCompBlock(float *out, int n);
+	void computeConvBlock(float *out, int n);
+	void computePongBlock(float *out, int n);
+	
+	void fetchInputs(int n);
 };
 
 #endif
@@ -0,0 +1,170 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "wpprofile.hpp"
+
+#ifdef WP_PROFILE
+
+#include <chrono>
+#include <cstdio>
+
+// A block is a spike if it takes this many times as long per frame as the average
+// of about the last 1/WP_PROFILE_AVERAGE_RATE blocks.
+#define WP_PROFILE_SPIKE_FACTOR 2.0
+#define WP_PROFILE_AVERAGE_RATE 0.01
+
+const char *const profileProbeNames[kNumProbes] = {
+	"Block", "DataExchange", "LockWait", "FillBuffer", "UpdateFreqAndWave"};
+
+thread_local Profiler *Profiler::current = NULL;
+
+Profiler::Profiler()
+	: deadlineMisses(0), spikes(0), cycleSpikes(0), lockMisses(0), droppedBlocks(0),
+	  ringWrite(0), ringRead(0), block(), originNs(now()), averageFrameNs(0.0)
+{
+	for (int p = 0; p < kNumProbes; p++) {
+		probes[p].count.store(0);
+		probes[p].totalNs.store(0);
+		probes[p].maxNs.store(0);
+		for (int b = 0; b < WP_PROFILE_BUCKETS; b++)
+			probes[p].buckets[b].store(0);
+	}
+}
+
+long long Profiler::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::beginBlock(int frames, float sampleRate) {
+	current = this;
+	
+	block.startNs = now();
+	block.deadlineNs = (long long) (1.0e9 * frames / sampleRate);
+	block.lockWaitNs = 0;
+	block.frames = frames;
+	block.cycleEvents = 0;
+}
+
+void Profiler::endBlock() {
+	block.ns = now() - block.startNs;
+	block.startNs -= originNs;
+	current = NULL;
+	
+	record(kProbeBlock, block.ns);
+	
+	if (block.ns > block.deadlineNs)
+		increment(deadlineMisses);
+	
+	if (block.frames > 0) {
+		double nsPerFrame = (double) block.ns / block.frames;
+		
+		if (averageFrameNs > 0.0 && nsPerFrame > WP_PROFILE_SPIKE_FACTOR * averageFrameNs) {
+			increment(spikes);
+			if (block.cycleEvents > 0)
+				increment(cycleSpikes);
+		}
+		
+		averageFrameNs = (averageFrameNs > 0.0)
+		                 ? averageFrameNs + WP_PROFILE_AVERAGE_RATE * (nsPerFrame - averageFrameNs)
+		                 : nsPerFrame;
+	}
+	
+	// Single producer: only the reader moves ringRead.
+	unsigned int w = ringWrite.load(std::memory_order_relaxed);
+	
+	if (w - ringRead.load(std::memory_order_acquire) >= WP_PROFILE_RING_SIZE)
+		increment(droppedBlocks);
+	else {
+		ring[w & (WP_PROFILE_RING_SIZE - 1)] = block;
+		ringWrite.store(w + 1, std::memory_order_release);
+	}
+}
+
+void Profiler::record(ProfileProbe probe, long long ns) {
+	Counters &c = probes[probe];
+	unsigned long long n = (ns > 0) ? (unsigned long long) ns : 0;
+	int bucket = 0;
+	
+	while (bucket < WP_PROFILE_BUCKETS - 1 && n >> (bucket + 1) != 0)
+		bucket++;
+	
+	increment(c.count);
+	increment(c.totalNs, n);
+	increment(c.buckets[bucket]);
+	if (n > c.maxNs.load(std::memory_order_relaxed))
+		c.maxNs.store(n, std::memory_order_relaxed);
+	
+	if (probe == kProbeLockWait)
+		block.lockWaitNs += n;
+	else if (probe == kProbeFillBuffer || probe == kProbeUpdateWave)
+		block.cycleEvents++;
+}
+
+int Profiler::readBlocks(ProfileBlock *out, int maxBlocks) {
+	unsigned int r = ringRead.load(std::memory_order_relaxed),
+	             w = ringWrite.load(std::memory_order_acquire);
+	int n = 0;
+	
+	for (; n < maxBlocks && r != w; n++, r++)
+		out[n] = ring[r & (WP_PROFILE_RING_SIZE - 1)];
+	
+	ringRead.store(r, std::memory_order_release);
+	return n;
+}
+
+bool Profiler::dump(const char *path) {
+	FILE *file = std::fopen(path, "w");
+	if (file == NULL)
+		return false;
+	
+	std::fprintf(file, "# Probes. Bucket b counts times from 2^b to 2^(b+1)-1 ns.\n");
+	std::fprintf(file, "probe,count,total_ns,max_ns");
+	for (int b = 0; b < WP_PROFILE_BUCKETS; b++)
+		std::fprintf(file, ",b%d", b);
+	std::fprintf(file, "\n");
+	
+	for (int p = 0; p < kNumProbes; p++) {
+		std::fprintf(file, "%s,%llu,%llu,%llu", profileProbeNames[p],
+			probes[p].count.load(), probes[p].totalNs.load(), probes[p].maxNs.load());
+		for (int b = 0; b < WP_PROFILE_BUCKETS; b++)
+			std::fprintf(file, ",%llu", probes[p].buckets[b].load());
+		std::fprintf(file, "\n");
+	}
+	
+	std::fprintf(file,
+		"\n# Counters.\n"
+		"deadline_misses,%llu\nspikes,%llu\ncycle_spikes,%llu\nlock_misses,%llu\ndropped_blocks,%llu\n",
+		deadlineMisses.load(), spikes.load(), cycleSpikes.load(), lockMisses.load(), droppedBlocks.load());
+	
+	std::fprintf(file, "\n# Blocks not read before the dump.\n");
+	std::fprintf(file, "start_ns,frames,ns,deadline_ns,lock_wait_ns,cycle_events\n");
+	
+	ProfileBlock blocks[256];
+	for (int n; (n = readBlocks(blocks, 256)) > 0;) {
+		for (int i = 0; i < n; i++)
+			std::fprintf(file, "%lld,%d,%lld,%lld,%lld,%d\n", blocks[i].startNs, blocks[i].frames,
+				blocks[i].ns, blocks[i].deadlineNs, blocks[i].lockWaitNs, blocks[i].cycleEvents);
+	}
+	
+	return std::fclose(file) == 0;
+}
+
+#endif
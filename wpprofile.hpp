@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_WPPROFILE_HPP
+#define WP_WPPROFILE_HPP
+
+// Real-time instrumentation. Only compiled in when WP_PROFILE is defined (the LOSTTECH_PROFILE
+// CMake option, or "make profile=1"). Otherwise the WP_PROFILE_* macros expand to nothing.
+//
+// The processing thread times each block and the probes inside it into per-probe histograms
+// and a lock-free ring of block records. Any other thread can read the ring or dump everything
+// to a file while processing goes on.
+
+#ifdef WP_PROFILE
+
+#include <atomic>
+#include <cstddef>
+
+enum ProfileProbe {
+	kProbeBlock,        // A whole block (WavePlug::processReplacing).
+	kProbeDataExchange, // WavePlug::doThreadSynchronizedDataExchange.
+	kProbeLockWait,     // Waiting for the plugin lock on the processing thread.
+	kProbeFillBuffer,   // Synthesizer::fillBuffer, run at synthesized cycle boundaries.
+	kProbeUpdateWave,   // Analyzer::updateFreqAndWave, run at analyzed cycle boundaries.
+	
+	kNumProbes
+};
+
+extern const char *const profileProbeNames[kNumProbes];
+
+// Histogram bucket b counts times from 2^b to 2^(b+1) - 1 ns.
+#define WP_PROFILE_BUCKETS 32
+
+// Number of block records the ring holds. Must be a power of 2.
+#define WP_PROFILE_RING_SIZE 4096
+
+struct ProfileBlock {
+	long long startNs;    // Since the profiler was created.
+	long long ns, deadlineNs, lockWaitNs;
+	int frames;
+	int cycleEvents;      // Number of fillBuffer and updateFreqAndWave calls.
+};
+
+class Profiler {
+private:
+	// Written by the processing thread only, so increments are a relaxed load and store.
+	struct Counters {
+		std::atomic<unsigned long long> count, totalNs, maxNs, buckets[WP_PROFILE_BUCKETS];
+	} probes[kNumProbes];
+	
+	// A spike is a block that takes more than twice the recent average time per frame.
+	// cycleSpikes counts the spikes with cycle boundary work in them.
+	std::atomic<unsigned long long> deadlineMisses, spikes, cycleSpikes, lockMisses, droppedBlocks;
+	
+	ProfileBlock ring[WP_PROFILE_RING_SIZE];
+	std::atomic<unsigned int> ringWrite, ringRead;
+	
+	// State of the block being timed. Processing thread only.
+	ProfileBlock block;
+	long long originNs;
+	double averageFrameNs;
+	
+	static thread_local Profiler *current;
+	
+	static void increment(std::atomic<unsigned long long> &counter, unsigned long long n = 1) {
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+	
+public:
+	Profiler();
+	
+	// Monotonic time in nanoseconds.
+	static long long now();
+	
+	// The profiler of the block being timed on this thread, or NULL.
+	static Profiler *getCurrent() {return current;}
+	
+	// ---<<< Processing thread >>>---
+	
+	// Makes this the current profiler and starts timing a block of frames samples,
+	// which must be processed within frames/sampleRate seconds.
+	void beginBlock(int frames, float sampleRate);
+	void endBlock();
+	
+	void record(ProfileProbe probe, long long ns);
+	
+	// The processing thread gave up on the lock because another thread held it.
+	void countLockMiss() {increment(lockMisses);}
+	
+	// ---<<< Any thread >>>---
+	
+	// Moves up to maxBlocks of the oldest block records to out and returns how many.
+	// Only one thread may read at a time.
+	int readBlocks(ProfileBlock *out, int maxBlocks);
+	
+	// Writes the histograms and counters, followed by the unread block records as CSV.
+	// Returns false if the file couldn't be written.
+	bool dump(const char *path);
+};
+
+// Times the enclosing scope into probe of the current profiler, if there is one.
+class ProfileTimer {
+private:
+	Profiler *profiler;
+	ProfileProbe probe;
+	long long startNs;
+	
+public:
+	ProfileTimer(ProfileProbe p) : profiler(Profiler::getCurrent()), probe(p) {
+		startNs = (profiler != NULL) ? Profiler::now() : 0;
+	}
+	
+	~ProfileTimer() {
+		if (profiler != NULL)
+			profiler->record(probe, Profiler::now() - startNs);
+	}
+};
+
+// Times the enclosing scope as one block.
+class ProfileBlockScope {
+private:
+	Profiler *profiler;
+	
+public:
+	ProfileBlockScope(Profiler *p, int frames, float sampleRate) : profiler(p) {
+		profiler->beginBlock(frames, sampleRate);
+	}
+	
+	~ProfileBlockScope() {profiler->endBlock();}
+};
+
+#define WP_PROFILE_BLOCK(profiler, frames, sampleRate) \
+	ProfileBlockScope wpProfileBlockScope((profiler), (frames), (sampleRate))
+#define WP_PROFILE_PROBE(probe) ProfileTimer wpProfileTimer(probe)
+#define WP_PROFILE_LOCK_MISS() \
+	do {if (Profiler::getCurrent() != NULL) Profiler::getCurrent()->countLockMiss();} while (0)
+
+#else
+
+#define WP_PROFILE_BLOCK(profiler, frames, sampleRate)
+#define WP_PROFILE_PROBE(probe)
+#define WP_PROFILE_LOCK_MISS()
+
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+/*
+Copyright (c) 2007 Johan Sarge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef WP_WPSYNC_HPP
+#define WP_WPSYNC_HPP
+
+#include "wpstdinclude.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <mutex>
+#endif
+
+// Recursive mutual exclusion lock. Uses a spinning Win32 critical section on Windows
+// and std::recursive_mutex everywhere else, so the processing components build on any
+// platform.
+class CriticalSection {
+private:
+#ifdef _WIN32
+	CRITICAL_SECTION section;
+#else
+	std::recursive_mutex mutex;
+#endif
+	
+	CriticalSection(const CriticalSection &);
+	CriticalSection &operator=(const CriticalSection &);
+	
+public:
+	CriticalSection() {
+#if !defined(_WIN32)
+#elif defined(WP_OLD_WINDOWS)
+		InitializeCriticalSection(&section);
+#else
+		if (!InitializeCriticalSectionAndSpinCount(&section, 0x80000400))
+			throw std::runtime_error(
+				"CriticalSection::CriticalSection - Failed to initialize critical section.");
+#endif
+	}
+	
+	~CriticalSection() {
+#ifdef _WIN32
+		DeleteCriticalSection(&section);
+#endif
+	}
+	
+#ifdef _WIN32
+	void enter() {EnterCriticalSection(&section);}
+	bool tryEnter() {return TryEnterCriticalSection(&section) != 0;}
+	void leave() {LeaveCriticalSection(&section);}
+#else
+	void enter() {mutex.lock();}
+	bool tryEnter() {return mutex.try_lock();}
+	void leave() {mutex.unlock();}
+#endif
+};
+
+#endif